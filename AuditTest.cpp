@@ -0,0 +1,250 @@
+/**
+ * Checks that the Fraction operations neither allocate nor throw when
+ * nothing overflows, over every workload of benchmarks/BenchWorkloads.hpp.
+ *
+ * This binary (make test_audit) replaces operator new, malloc, calloc and
+ * realloc, and __cxa_throw, which every throw expression calls; while a call
+ * is audited they count what they see, then forward to the real ones. Calls
+ * that end in overflow_error are the overflow path and aren't held to this.
+ * The stream operators are known to allocate, through the stream's buffer,
+ * and are only reported.
+ */
+
+#include "doctest.h"
+#include "sources/Fraction.hpp"
+#include "benchmarks/BenchWorkloads.hpp"
+
+#include <cstdlib>
+#include <dlfcn.h>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+using namespace ariel;
+using namespace std;
+
+static thread_local bool auditing = false;
+static thread_local size_t allocations = 0;
+static thread_local size_t throws = 0;
+static thread_local const char* thrown_type = nullptr;
+
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+
+    void* malloc(size_t size) {
+        if (auditing)
+            allocations++;
+        return __libc_malloc(size);
+    }
+    void* calloc(size_t count, size_t size) {
+        if (auditing)
+            allocations++;
+        return __libc_calloc(count, size);
+    }
+    void* realloc(void* pointer, size_t size) {
+        if (auditing)
+            allocations++;
+        return __libc_realloc(pointer, size);
+    }
+
+    // The type is a type_info*; void* is how the compiler declares it.
+    [[noreturn]] void __cxa_throw(void* exception, void* type, void (*destructor)(void*)) {
+        using Throw = void (*)(void*, void*, void (*)(void*));
+        static Throw real_throw = reinterpret_cast<Throw>(dlsym(RTLD_NEXT, "__cxa_throw"));
+        if (auditing) {
+            throws++;
+            thrown_type = static_cast<const type_info*>(type)->name();
+        }
+        real_throw(exception, type, destructor);
+        abort();
+    }
+}
+
+// Counted once here; they don't go through malloc above. operator new[]
+// and the default deletes forward to these and to free.
+void* operator new(size_t size) {
+    if (auditing)
+        allocations++;
+    void* pointer = __libc_malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr)
+        throw bad_alloc();
+    return pointer;
+}
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    if (auditing)
+        allocations++;
+    return __libc_malloc(size == 0 ? 1 : size);
+}
+
+struct AuditResult {
+    size_t allocations;
+    size_t throws;
+    bool overflowed;
+};
+
+template <typename Operation>
+static AuditResult audit(Operation operation) {
+    allocations = 0;
+    throws = 0;
+    bool overflowed = false;
+    auditing = true;
+    try {
+        operation();
+    }
+    catch (const overflow_error&) {
+        overflowed = true;
+    }
+    auditing = false;
+    return {allocations, throws, overflowed};
+}
+
+static volatile int sink;
+
+using Operation = function<void(const Fraction&, const Fraction&, float)>;
+
+static vector<pair<string, Operation>> fraction_operations() {
+    return {
+        {"Fraction()", [](const Fraction&, const Fraction&, float) { Fraction value; sink = value.getNumerator(); }},
+        {"Fraction(int, int)", [](const Fraction& lhs, const Fraction& rhs, float) {
+            sink = Fraction(lhs.getNumerator(), rhs.getDenominator()).getNumerator();
+        }},
+        {"Fraction(float)", [](const Fraction&, const Fraction&, float number) { sink = Fraction(number).getNumerator(); }},
+        {"Fraction(const Fraction&)", [](const Fraction& lhs, const Fraction&, float) { Fraction value(lhs); sink = value.getNumerator(); }},
+        {"Fraction(Fraction&&)", [](const Fraction& lhs, const Fraction&, float) {
+            Fraction source(lhs);
+            Fraction value(move(source));
+            sink = value.getNumerator();
+        }},
+        {"operator=(const Fraction&)", [](const Fraction& lhs, const Fraction& rhs, float) {
+            Fraction value(lhs);
+            value = rhs;
+            sink = value.getNumerator();
+        }},
+        {"operator=(Fraction&&)", [](const Fraction& lhs, const Fraction& rhs, float) {
+            Fraction value(lhs);
+            Fraction source(rhs);
+            value = move(source);
+            sink = value.getNumerator();
+        }},
+        {"setNumerator", [](const Fraction& lhs, const Fraction& rhs, float) {
+            Fraction value(lhs);
+            value.setNumerator(rhs.getNumerator());
+            sink = value.getNumerator();
+        }},
+        {"setDenominator", [](const Fraction& lhs, const Fraction& rhs, float) {
+            Fraction value(lhs);
+            value.setDenominator(rhs.getDenominator());
+            sink = value.getDenominator();
+        }},
+        {"-fraction", [](const Fraction& lhs, const Fraction&, float) { sink = (-lhs).getNumerator(); }},
+        {"fraction + fraction", [](const Fraction& lhs, const Fraction& rhs, float) { sink = (lhs + rhs).getNumerator(); }},
+        {"fraction - fraction", [](const Fraction& lhs, const Fraction& rhs, float) { sink = (lhs - rhs).getNumerator(); }},
+        {"fraction * fraction", [](const Fraction& lhs, const Fraction& rhs, float) { sink = (lhs * rhs).getNumerator(); }},
+        {"fraction / fraction", [](const Fraction& lhs, const Fraction& rhs, float) { sink = (lhs / rhs).getNumerator(); }},
+        {"fraction + float", [](const Fraction& lhs, const Fraction&, float number) { sink = (lhs + number).getNumerator(); }},
+        {"fraction - float", [](const Fraction& lhs, const Fraction&, float number) { sink = (lhs - number).getNumerator(); }},
+        {"fraction * float", [](const Fraction& lhs, const Fraction&, float number) { sink = (lhs * number).getNumerator(); }},
+        {"fraction / float", [](const Fraction& lhs, const Fraction&, float number) { sink = (lhs / number).getNumerator(); }},
+        {"float + fraction", [](const Fraction& lhs, const Fraction&, float number) { sink = (number + lhs).getNumerator(); }},
+        {"float - fraction", [](const Fraction& lhs, const Fraction&, float number) { sink = (number - lhs).getNumerator(); }},
+        {"float * fraction", [](const Fraction& lhs, const Fraction&, float number) { sink = (number * lhs).getNumerator(); }},
+        {"float / fraction", [](const Fraction& lhs, const Fraction&, float number) { sink = (number / lhs).getNumerator(); }},
+        {"comparisons", [](const Fraction& lhs, const Fraction& rhs, float) {
+            sink = (lhs == rhs) + (lhs != rhs) + (lhs < rhs) + (lhs > rhs) + (lhs <= rhs) + (lhs >= rhs);
+        }},
+        {"comparisons with float", [](const Fraction& lhs, const Fraction&, float number) {
+            sink = (lhs == number) + (lhs != number) + (lhs < number) + (lhs > number) + (lhs <= number) + (lhs >= number)
+                 + (number == lhs) + (number != lhs) + (number < lhs) + (number > lhs) + (number <= lhs) + (number >= lhs);
+        }},
+        {"++ and --", [](const Fraction& lhs, const Fraction&, float) {
+            Fraction value(lhs);
+            ++value;
+            value++;
+            --value;
+            value--;
+            sink = value.getNumerator();
+        }},
+    };
+}
+
+TEST_SUITE("Audit") {
+    TEST_CASE("The interposers see allocations and throws") {
+        AuditResult result = audit([] { delete new int(1); });
+        CHECK_EQ(result.allocations, 1);
+        result = audit([] { free(malloc(16)); });
+        CHECK_EQ(result.allocations, 1);
+        result = audit([] { sink = (Fraction(numeric_limits<int>::max(), 1) + Fraction(1, 1)).getNumerator(); });
+        CHECK(result.overflowed);
+        CHECK_EQ(result.throws, 1);
+        CHECK_EQ(string(thrown_type), typeid(overflow_error).name());
+        result = audit([] {
+            try {
+                throw runtime_error("caught inside");
+            }
+            catch (const runtime_error&) {
+            }
+        });
+        CHECK_FALSE(result.overflowed);
+        CHECK_EQ(result.throws, 1);
+    }
+
+    TEST_CASE("Operations don't allocate or throw unless they overflow") {
+        vector<pair<string, Operation>> operations = fraction_operations();
+        for (bench::Distribution distribution : bench::all_distributions) {
+            bench::Workload workload = bench::make_workload(distribution, 1024);
+            for (const auto& [name, operation] : operations) {
+                size_t checked = 0;
+                size_t failed = 0;
+                string first_failure;
+                for (size_t index = 0; index < workload.lhs.size(); index++) {
+                    const Fraction& lhs = workload.lhs[index];
+                    const Fraction& rhs = workload.rhs[index];
+                    float number = workload.floats[index];
+                    AuditResult result = audit([&] { operation(lhs, rhs, number); });
+                    if (result.overflowed)
+                        continue;
+                    checked++;
+                    if (result.allocations == 0 && result.throws == 0)
+                        continue;
+                    if (failed++ == 0) {
+                        ostringstream operands;
+                        operands << lhs << ", " << rhs << ", " << number << ": " << result.allocations << " allocations, "
+                                 << result.throws << " throws" << (result.throws > 0 ? string(" of ") + thrown_type : "");
+                        first_failure = operands.str();
+                    }
+                }
+                INFO(name, " [", bench::distribution_name(distribution), "] ", checked, " calls checked");
+                CHECK_MESSAGE(failed == 0, failed, " calls failed, the first on ", first_failure);
+            }
+        }
+    }
+
+    TEST_CASE("Stream operators are the known allocators") {
+        bench::Workload workload = bench::make_workload(bench::Distribution::uniform, 1024);
+        size_t output_allocations = 0;
+        size_t input_allocations = 0;
+        ostringstream output;
+        for (const Fraction& value : workload.lhs) {
+            AuditResult written = audit([&] { output << value << ' '; });
+            output_allocations += written.allocations;
+            CHECK_EQ(written.throws, 0);
+
+            string text = to_string(value.getNumerator()) + " " + to_string(value.getDenominator());
+            istringstream input(text);
+            Fraction parsed;
+            AuditResult result = audit([&] { input >> parsed; });
+            input_allocations += result.allocations;
+            CHECK_EQ(result.throws, 0);
+            CHECK_EQ(parsed, value);
+        }
+        // The output allocates whenever the stream's buffer grows.
+        MESSAGE("operator<< into one ostringstream: ", output_allocations, " allocations in ", workload.lhs.size(), " calls");
+        MESSAGE("operator>> from an istringstream: ", input_allocations, " allocations in ", workload.lhs.size(), " calls");
+    }
+}
@@ -0,0 +1,1370 @@
+#include "doctest.h"
+#include "sources/Fraction.hpp"
+#include "sources/BasicFraction.hpp"
+#include "sources/FractionExpr.hpp"
+#include "sources/PackedFraction.hpp"
+#include "sources/AtomicFraction.hpp"
+#include "sources/ShardedAccumulator.hpp"
+#include "sources/FractionChars.hpp"
+#include "sources/FractionFormat.hpp"
+#include "sources/FractionCsv.hpp"
+#include "sources/FractionFile.hpp"
+#include "sources/FractionCodec.hpp"
+#include "sources/Varint.hpp"
+#include "sources/FractionKey.hpp"
+#include "sources/FractionSort.hpp"
+#include "sources/ExternalSort.hpp"
+#include "sources/FractionHash.hpp"
+#include "sources/FractionStats.hpp"
+#include "sources/FractionReference.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ariel;
+using namespace std;
+
+// Deterministic test data: one step of a 64-bit LCG (Knuth's MMIX constants).
+static uint64_t next_random(uint64_t& state) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state;
+}
+
+TEST_SUITE("Reduction policies") {
+    TEST_CASE("Always reduces like Fraction") {
+        EagerFraction frac1(6, 8);
+        CHECK_EQ(frac1.getNumerator(), 3);
+        CHECK_EQ(frac1.getDenominator(), 4);
+
+        EagerFraction frac2 = frac1 * EagerFraction(2, 3);
+        CHECK_EQ(frac2.getNumerator(), 1);
+        CHECK_EQ(frac2.getDenominator(), 2);
+        CHECK_EQ(Fraction(frac2), Fraction(1, 2));
+    }
+
+    TEST_CASE("Lazy only strips powers of two along the way") {
+        LazyFraction frac1(6, 9);
+        CHECK_EQ(frac1.getNumerator(), 6);
+        CHECK_EQ(frac1.getDenominator(), 9);
+        CHECK_FALSE(frac1.isNormalized());
+
+        LazyFraction frac2(12, 8);
+        CHECK_EQ(frac2.getNumerator(), 3);
+        CHECK_EQ(frac2.getDenominator(), 2);
+
+        frac1.normalize();
+        CHECK_EQ(frac1.getNumerator(), 2);
+        CHECK_EQ(frac1.getDenominator(), 3);
+    }
+
+    TEST_CASE("Lazy reduces when a result would overflow") {
+        const int big = 46341; // big * big > INT_MAX
+        LazyFraction frac1(3 * big, 3);
+        LazyFraction frac2(big, big);
+        LazyFraction product = frac1 * frac2;
+        CHECK_EQ(Fraction(product), Fraction(big, 1));
+        CHECK(product.isNormalized());
+
+        LazyFraction huge(numeric_limits<int>::max(), 1);
+        CHECK_THROWS_AS(huge * huge, overflow_error);
+    }
+
+    TEST_CASE("Explicit never reduces on its own") {
+        ExplicitFraction frac1(4, 8);
+        CHECK_EQ(frac1.getNumerator(), 4);
+        CHECK_EQ(frac1.getDenominator(), 8);
+
+        ExplicitFraction sum = frac1 + ExplicitFraction(2, 8);
+        CHECK_EQ(sum.getNumerator(), 48);
+        CHECK_EQ(sum.getDenominator(), 64);
+        CHECK_EQ(sum, ExplicitFraction(3, 4));
+
+        ExplicitFraction big(1, 50000);
+        CHECK_THROWS_AS(big * big, overflow_error);
+    }
+
+    TEST_CASE("Comparisons and output see through unreduced values") {
+        ExplicitFraction frac1(2, 4);
+        ExplicitFraction frac2(3, 6);
+        CHECK_EQ(frac1, frac2);
+        CHECK_LT(frac1, ExplicitFraction(2, 3));
+        CHECK_GE(frac1, 0.5);
+
+        ExplicitFraction negative(3, -6);
+        CHECK_EQ(negative.getDenominator(), 6);
+
+        stringstream output;
+        output << frac1 << " " << negative;
+        CHECK_EQ(output.str(), "1/2 -1/2");
+    }
+
+    TEST_CASE("Mixed with Fraction and floats") {
+        LazyFraction frac1(1, 4);
+        LazyFraction sum = frac1 + Fraction(1, 4);
+        CHECK_EQ(Fraction(sum), Fraction(1, 2));
+
+        LazyFraction scaled = 2.0 * frac1;
+        CHECK_EQ(Fraction(scaled), Fraction(1, 2));
+
+        frac1++;
+        CHECK_EQ(Fraction(frac1), Fraction(5, 4));
+        CHECK_THROWS_AS(frac1 / LazyFraction(), runtime_error);
+        CHECK_THROWS_AS(LazyFraction(1, 0), invalid_argument);
+    }
+}
+
+TEST_SUITE("Fused expressions") {
+    TEST_CASE("Same values as the Fraction operators") {
+        Fraction frac1(5, 3);
+        Fraction frac2(14, 21);
+
+        Fraction fused = expr::fuse(frac1) + frac2 - 1;
+        CHECK_EQ(fused, frac1 + frac2 - 1);
+
+        Fraction frac3(7, 9);
+        Fraction frac4(-3, 4);
+        Fraction mixed = (expr::fuse(frac1) * frac2 + frac3) / frac4;
+        CHECK_EQ(mixed, (frac1 * frac2 + frac3) / frac4);
+
+        Fraction negated = -(expr::fuse(frac1) - frac2) * 2.5;
+        CHECK_EQ(negated, -(frac1 - frac2) * 2.5);
+
+        Fraction left_scalar = 2 - expr::fuse(frac1);
+        CHECK_EQ(left_scalar, Fraction(1, 3));
+    }
+
+    TEST_CASE("Only the final value has to fit in an int") {
+        Fraction big(numeric_limits<int>::max(), 1);
+        Fraction half(1, 2);
+
+        CHECK_THROWS_AS(big * big / big, overflow_error);
+        Fraction fused = expr::fuse(big) * big / big * half;
+        CHECK_EQ(fused, Fraction(numeric_limits<int>::max(), 2));
+
+        CHECK_THROWS_AS(Fraction(expr::fuse(big) * big), overflow_error);
+    }
+
+    TEST_CASE("Errors and output") {
+        Fraction frac1(1, 2);
+        CHECK_THROWS_AS(Fraction(expr::fuse(frac1) / Fraction()), runtime_error);
+
+        stringstream output;
+        output << expr::fuse(frac1) + Fraction(1, 3);
+        CHECK_EQ(output.str(), "5/6");
+    }
+}
+
+TEST_SUITE("Packed fractions") {
+    TEST_CASE("Sizes and canonical form") {
+        CHECK_EQ(sizeof(Fraction32), 4);
+        CHECK_EQ(sizeof(Fraction64), 8);
+
+        Fraction32 frac1(6, -8);
+        CHECK_EQ(frac1.getNumerator(), -3);
+        CHECK_EQ(frac1.getDenominator(), 4);
+
+        Fraction64 frac2(0, 7);
+        CHECK_EQ(frac2.getNumerator(), 0);
+        CHECK_EQ(frac2.getDenominator(), 1);
+        CHECK_THROWS_AS(Fraction32(1, 0), invalid_argument);
+    }
+
+    TEST_CASE("Checked conversions") {
+        CHECK_EQ(Fraction(Fraction32(Fraction(-5, 12))), Fraction(-5, 12));
+        CHECK_THROWS_AS(Fraction32(Fraction(40000, 3)), overflow_error);
+        CHECK_THROWS_AS(Fraction32(Fraction(1, 70000)), overflow_error);
+
+        Fraction64 wide_denominator(1, 4000000000LL);
+        CHECK_EQ(wide_denominator.getDenominator(), 4000000000U);
+        CHECK_THROWS_AS(static_cast<Fraction>(wide_denominator), overflow_error);
+        CHECK_EQ(Fraction(Fraction64(Fraction(numeric_limits<int>::min(), 7))), Fraction(numeric_limits<int>::min(), 7));
+    }
+
+    TEST_CASE("Arithmetic matches Fraction") {
+        Fraction32 frac1(5, 3);
+        Fraction32 frac2(14, 21);
+        CHECK_EQ(Fraction(frac1 + frac2), Fraction(5, 3) + Fraction(14, 21));
+        CHECK_EQ(Fraction(frac1 - frac2), Fraction(5, 3) - Fraction(14, 21));
+        CHECK_EQ(Fraction(frac1 * frac2), Fraction(5, 3) * Fraction(14, 21));
+        CHECK_EQ(Fraction(frac1 / frac2), Fraction(5, 3) / Fraction(14, 21));
+        CHECK_EQ(Fraction(-frac1), Fraction(-5, 3));
+        CHECK_EQ(Fraction(frac1 * 2.5), Fraction(25, 6));
+        CHECK_THROWS_AS(frac1 / Fraction32(), runtime_error);
+
+        ++frac1;
+        CHECK_EQ(frac1, Fraction32(8, 3));
+        CHECK_EQ(frac1--, Fraction32(8, 3));
+        CHECK_EQ(frac1, Fraction32(5, 3));
+
+        Fraction32 big(30000, 1);
+        CHECK_THROWS_AS(big + big, overflow_error);
+        Fraction64 wide_big(30000, 1);
+        CHECK_EQ((wide_big + wide_big).getNumerator(), 60000);
+    }
+
+    TEST_CASE("Comparisons") {
+        Fraction32 frac1(1, 3);
+        Fraction32 frac2(2, 6);
+        Fraction32 frac3(-1, 2);
+        CHECK_EQ(frac1, frac2);
+        CHECK_LT(frac3, frac1);
+        CHECK_GT(frac1, frac3);
+        CHECK_LE(frac1, frac2);
+        CHECK_GE(frac1, frac2);
+        CHECK_NE(frac1, frac3);
+
+        Fraction64 frac4(numeric_limits<int32_t>::max(), numeric_limits<uint32_t>::max());
+        Fraction64 frac5(numeric_limits<int32_t>::max() - 1, numeric_limits<uint32_t>::max() - 2);
+        CHECK_GT(frac4, frac5);
+
+        stringstream output;
+        output << frac3;
+        CHECK_EQ(output.str(), "-1/2");
+    }
+
+    TEST_CASE("Fraction128 comparisons agree with the exact cross products") {
+        const int64_t big = numeric_limits<int64_t>::max();
+        const uint64_t wide_big = numeric_limits<uint64_t>::max();
+        auto exact_less = [](const Fraction128& lhs, const Fraction128& rhs) {
+            return static_cast<__int128>(lhs.getNumerator()) * rhs.getDenominator() <
+                   static_cast<__int128>(rhs.getNumerator()) * lhs.getDenominator();
+        };
+
+        // Close calls, which only the exact fallback can tell apart.
+        Fraction128 frac1(big, wide_big);
+        Fraction128 frac2(big - 1, wide_big - 2);
+        CHECK_EQ(frac1 < frac2, exact_less(frac1, frac2));
+        CHECK_EQ(frac2 < frac1, exact_less(frac2, frac1));
+        CHECK_EQ(Fraction128::filteredLess(frac1, frac2), exact_less(frac1, frac2));
+        CHECK_EQ(Fraction128::filteredLess(frac2, frac1), exact_less(frac2, frac1));
+        CHECK_FALSE(frac1 < frac1);
+        CHECK_FALSE(Fraction128::filteredLess(frac1, frac1));
+        CHECK_LT(Fraction128(big - 1, 1), Fraction128(big, 1));
+        CHECK_LT(Fraction128(numeric_limits<int64_t>::min(), 1), Fraction128(numeric_limits<int64_t>::min() + 1, 1));
+        CHECK_LT(Fraction128(1, wide_big), Fraction128(1, wide_big - 1));
+        CHECK_LT(Fraction128(-1, wide_big - 1), Fraction128(-1, wide_big));
+        CHECK_LT(Fraction128(-1, wide_big), Fraction128(0, 1));
+
+        uint64_t state = 11;
+        auto next = [&state] { return next_random(state); };
+        for (int round = 0; round < 10000; round++) {
+            int shift = int(next() >> 58);
+            int64_t numerator = static_cast<int64_t>(next()) >> shift;
+            uint64_t denominator = (next() >> shift) | 1;
+            Fraction128 lhs(numerator, denominator);
+            // Every other one a neighbour of lhs.
+            Fraction128 rhs = round % 2 == 0 ? Fraction128(static_cast<int64_t>(next()) >> shift, (next() >> shift) | 1)
+                                             : Fraction128(static_cast<__int128>(numerator) + 1, denominator);
+            CHECK_EQ(lhs < rhs, exact_less(lhs, rhs));
+            CHECK_EQ(Fraction128::filteredLess(lhs, rhs), exact_less(lhs, rhs));
+            CHECK_EQ(Fraction128::filteredLess(rhs, lhs), exact_less(rhs, lhs));
+        }
+    }
+}
+
+TEST_SUITE("AtomicFraction") {
+    TEST_CASE("Load, store and compare_exchange") {
+        CHECK(AtomicFraction::is_always_lock_free);
+
+        AtomicFraction shared(Fraction(1, 2));
+        CHECK_EQ(shared.load(), Fraction(1, 2));
+
+        shared.store(Fraction(2, 6));
+        CHECK_EQ(shared.load(), Fraction(1, 3));
+
+        Fraction expected(1, 4);
+        CHECK_FALSE(shared.compare_exchange_strong(expected, Fraction(3, 4)));
+        CHECK_EQ(expected, Fraction(1, 3));
+        CHECK(shared.compare_exchange_strong(expected, Fraction(3, 4)));
+        CHECK_EQ(shared.exchange(Fraction(-1, 5)), Fraction(3, 4));
+        CHECK_EQ(Fraction(shared), Fraction(-1, 5));
+    }
+
+    TEST_CASE("Read-modify-write operations") {
+        AtomicFraction shared(Fraction(1, 2));
+        CHECK_EQ(shared.fetch_add(Fraction(1, 3)), Fraction(1, 2));
+        CHECK_EQ(shared.fetch_mul(Fraction(6, 5)), Fraction(5, 6));
+        CHECK_EQ(shared.fetch_sub(Fraction(1, 2)), Fraction(1, 1));
+        CHECK_EQ(shared.fetch_div(Fraction(1, 4)), Fraction(1, 2));
+        CHECK_EQ(shared.load(), Fraction(2, 1));
+
+        CHECK_THROWS_AS(shared.fetch_div(Fraction()), runtime_error);
+        CHECK_EQ(shared.load(), Fraction(2, 1));
+    }
+
+    TEST_CASE("Concurrent fetch_add loses no update") {
+        AtomicFraction shared;
+        vector<thread> workers;
+        for (int index = 0; index < 4; index++)
+            workers.emplace_back([&shared]() {
+                for (int op = 0; op < 1000; op++)
+                    shared.fetch_add(Fraction(1, 4));
+            });
+        for (thread& worker : workers)
+            worker.join();
+
+        CHECK_EQ(shared.load(), Fraction(1000, 1));
+    }
+}
+
+TEST_SUITE("ShardedAccumulator") {
+    TEST_CASE("Sums across shards") {
+        ShardedAccumulator total(5);
+        CHECK_EQ(total.shardCount(), 5);
+        CHECK_EQ(total.snapshot(), Fraction());
+
+        total.add(Fraction(1, 3));
+        total += Fraction(1, 6);
+        CHECK_EQ(total.snapshot(), Fraction(1, 2));
+
+        total.reset();
+        CHECK_EQ(total.snapshot(), Fraction());
+        CHECK_GE(ShardedAccumulator().shardCount(), 1);
+    }
+
+    TEST_CASE("Concurrent adds from more threads than shards") {
+        ShardedAccumulator total(3);
+        vector<thread> workers;
+        for (int index = 0; index < 6; index++)
+            workers.emplace_back([&total, index]() {
+                for (int op = 0; op < 500; op++)
+                    total.add(Fraction(1, index + 1));
+            });
+        for (thread& worker : workers)
+            worker.join();
+
+        // 500 * (1 + 1/2 + 1/3 + 1/4 + 1/5 + 1/6) = 500 * 49/20
+        CHECK_EQ(total.snapshot(), Fraction(1225, 1));
+    }
+
+    TEST_CASE("Threads that exit give their shard back") {
+        ShardedAccumulator total(4);
+        for (int round = 0; round < 7; round++) {
+            vector<thread> workers;
+            for (int index = 0; index < 3; index++)
+                workers.emplace_back([&total]() { total.add(Fraction(1, 2)); });
+            for (thread& worker : workers)
+                worker.join();
+        }
+        CHECK_EQ(total.snapshot(), Fraction(21, 2));
+
+        // This thread and three live ones: one shard each.
+        total.add(Fraction(1, 2));
+        atomic<int> ready(0);
+        vector<size_t> local(3);
+        vector<thread> workers;
+        for (size_t index = 0; index < 3; index++)
+            workers.emplace_back([&, index]() {
+                total.add(Fraction(1, 2));
+                local[index] = total.localShard();
+                ready++;
+                while (ready < 3)
+                    this_thread::yield();
+            });
+        for (thread& worker : workers)
+            worker.join();
+        local.push_back(total.localShard());
+        sort(local.begin(), local.end());
+        CHECK_EQ(local, vector<size_t>{0, 1, 2, 3});
+    }
+}
+
+// Parses the whole string; returns the error code and how much was consumed.
+static pair<errc, size_t> parse(const char* text, Fraction& value) {
+    from_chars_result result = from_chars(text, text + strlen(text), value);
+    return {result.ec, size_t(result.ptr - text)};
+}
+
+TEST_SUITE("from_chars parser") {
+    TEST_CASE("Accepted forms") {
+        Fraction value;
+        CHECK_EQ(parse("3/4", value), make_pair(errc(), size_t(3)));
+        CHECK_EQ(value, Fraction(3, 4));
+
+        CHECK_EQ(parse("-6 \t8", value), make_pair(errc(), size_t(5)));
+        CHECK_EQ(value, Fraction(-3, 4));
+
+        CHECK_EQ(parse("3/-9", value), make_pair(errc(), size_t(4)));
+        CHECK_EQ(value, Fraction(-1, 3));
+
+        CHECK_EQ(parse("-17", value), make_pair(errc(), size_t(3)));
+        CHECK_EQ(value, Fraction(-17, 1));
+
+        CHECK_EQ(parse("12.963", value), make_pair(errc(), size_t(6)));
+        CHECK_EQ(value, Fraction(12963, 1000));
+
+        CHECK_EQ(parse("-0.50000000000000000000000", value).first, errc());
+        CHECK_EQ(value, Fraction(-1, 2));
+
+        CHECK_EQ(parse("1234567890123456789/1234567890123456789", value).first, errc());
+        CHECK_EQ(value, Fraction(1, 1));
+
+        CHECK_EQ(parse("-2147483648", value).first, errc());
+        CHECK_EQ(value.getNumerator(), numeric_limits<int>::min());
+    }
+
+    TEST_CASE("Stops where the pattern ends") {
+        Fraction value;
+        CHECK_EQ(parse("5/", value), make_pair(errc(), size_t(1)));
+        CHECK_EQ(value, Fraction(5, 1));
+        CHECK_EQ(parse("5 x", value), make_pair(errc(), size_t(1)));
+        CHECK_EQ(parse("5.x", value), make_pair(errc(), size_t(1)));
+        CHECK_EQ(parse("1/2,3/4", value), make_pair(errc(), size_t(3)));
+        CHECK_EQ(value, Fraction(1, 2));
+
+        // Longer than one 16 byte block of digits
+        CHECK_EQ(parse("00000000000000000000000000000042/84;", value), make_pair(errc(), size_t(35)));
+        CHECK_EQ(value, Fraction(1, 2));
+    }
+
+    TEST_CASE("Errors leave the value alone") {
+        Fraction value(1, 7);
+        CHECK_EQ(parse("", value), make_pair(errc::invalid_argument, size_t(0)));
+        CHECK_EQ(parse("abc", value), make_pair(errc::invalid_argument, size_t(0)));
+        CHECK_EQ(parse(" 1/2", value), make_pair(errc::invalid_argument, size_t(0)));
+        CHECK_EQ(parse("-", value), make_pair(errc::invalid_argument, size_t(0)));
+        CHECK_EQ(parse("1/0", value), make_pair(errc::invalid_argument, size_t(3)));
+        CHECK_EQ(parse("2147483648", value), make_pair(errc::result_out_of_range, size_t(10)));
+        CHECK_EQ(parse("1/99999999999999999999999", value), make_pair(errc::result_out_of_range, size_t(25)));
+        CHECK_EQ(parse("0.0000000001", value), make_pair(errc::result_out_of_range, size_t(12)));
+        CHECK_EQ(value, Fraction(1, 7));
+    }
+}
+
+// Formats value into a string through to_chars.
+static string format_chars(const Fraction& value, FractionFormat format = FractionFormat::Ratio, int precision = 3) {
+    char buffer[64];
+    to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), value, format, precision);
+    return result.ec == errc() ? string(buffer, result.ptr) : "error";
+}
+
+TEST_SUITE("to_chars formatter") {
+    TEST_CASE("Ratio form matches operator<<") {
+        const Fraction values[] = {Fraction(), Fraction(-7, 3), Fraction(12963, 1000),
+                                   Fraction(numeric_limits<int>::min(), 1),
+                                   Fraction(-numeric_limits<int>::max(), numeric_limits<int>::max() - 1)};
+        for (const Fraction& value : values) {
+            stringstream output;
+            output << value;
+            CHECK_EQ(format_chars(value), output.str());
+            CHECK_LE(format_chars(value).size(), fraction_chars_max);
+
+            Fraction parsed;
+            string text = format_chars(value);
+            CHECK_EQ(from_chars(text.data(), text.data() + text.size(), parsed).ec, errc());
+            CHECK_EQ(parsed, value);
+        }
+    }
+
+    TEST_CASE("Mixed form") {
+        CHECK_EQ(format_chars(Fraction(7, 3), FractionFormat::Mixed), "2 1/3");
+        CHECK_EQ(format_chars(Fraction(-7, 3), FractionFormat::Mixed), "-2 1/3");
+        CHECK_EQ(format_chars(Fraction(-1, 3), FractionFormat::Mixed), "-1/3");
+        CHECK_EQ(format_chars(Fraction(6, 3), FractionFormat::Mixed), "2");
+        CHECK_EQ(format_chars(Fraction(0, 3), FractionFormat::Mixed), "0");
+        CHECK_EQ(format_chars(Fraction(-numeric_limits<int>::max(), 1073741824), FractionFormat::Mixed),
+                 "-1 1073741823/1073741824");
+    }
+
+    TEST_CASE("Decimal form") {
+        CHECK_EQ(format_chars(Fraction(12963, 1000), FractionFormat::Decimal), "12.963");
+        CHECK_EQ(format_chars(Fraction(-2, 3), FractionFormat::Decimal, 4), "-0.6667");
+        CHECK_EQ(format_chars(Fraction(1, 7), FractionFormat::Decimal, 20), "0.14285714285714285714");
+        CHECK_EQ(format_chars(Fraction(19999, 2000), FractionFormat::Decimal, 2), "10.00");
+        CHECK_EQ(format_chars(Fraction(5, 2), FractionFormat::Decimal, 0), "3");
+        CHECK_EQ(format_chars(Fraction(numeric_limits<int>::min(), 1), FractionFormat::Decimal, 2), "-2147483648.00");
+        CHECK_EQ(format_chars(Fraction(numeric_limits<int>::min(), 1), FractionFormat::Decimal, 2).size(),
+                 fraction_chars_max_decimal(2));
+    }
+
+    TEST_CASE("Too small a buffer") {
+        char buffer[4];
+        to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), Fraction(-7, 3), FractionFormat::Mixed);
+        CHECK_EQ(result.ec, errc::value_too_large);
+        CHECK_EQ(result.ptr, buffer + sizeof(buffer));
+        CHECK_EQ(to_chars(buffer, buffer + sizeof(buffer), Fraction(2, 3), FractionFormat::Decimal).ec, errc::value_too_large);
+        CHECK_EQ(to_chars(buffer, buffer + 3, Fraction(2, 3)).ec, errc());
+    }
+}
+
+// Formats value through a spec string, as std::format("{:spec}") would.
+static string format_spec(const Fraction& value, const string& spec_text) {
+    FractionFormatSpec spec;
+    if (!parse_format_spec(spec_text.begin(), spec_text.end(), spec).valid)
+        return "invalid";
+
+    string output;
+    format_fraction(back_inserter(output), value, spec);
+    return output;
+}
+
+// std::format parses specs at compile time, through its context's iterators.
+static constexpr bool valid_spec(string_view text) {
+    FractionFormatSpec spec;
+    FormatSpecResult result = parse_format_spec(text.begin(), text.end(), spec);
+    return result.valid && result.end == text.end() - 1 && spec.precision == 2;
+}
+static_assert(valid_spec(".2f}") && !valid_spec(".2m}"));
+
+TEST_SUITE("Format specs") {
+    TEST_CASE("Ratio and mixed") {
+        CHECK_EQ(format_spec(Fraction(-7, 3), ""), "-7/3");
+        CHECK_EQ(format_spec(Fraction(-7, 3), "r"), "-7/3");
+        CHECK_EQ(format_spec(Fraction(-7, 3), "m"), "-2 1/3");
+    }
+
+    TEST_CASE("Fixed decimal") {
+        CHECK_EQ(format_spec(Fraction(7, 3), "f"), "2.333");
+        CHECK_EQ(format_spec(Fraction(-2, 3), ".5f"), "-0.66667");
+        CHECK_EQ(format_spec(Fraction(-2, 3), ".5"), "-0.66667");
+        CHECK_EQ(format_spec(Fraction(19999, 2000), ".2"), "10.00");
+        CHECK_EQ(format_spec(Fraction(5, 2), ".0f"), "3");
+
+        // Agrees with to_chars where both apply
+        const Fraction values[] = {Fraction(1, 7), Fraction(-999999, 1000000), Fraction(numeric_limits<int>::max(), 3)};
+        for (const Fraction& value : values)
+            CHECK_EQ(format_spec(value, ".6f"), format_chars(value, FractionFormat::Decimal, 6));
+    }
+
+    TEST_CASE("Repeating decimal") {
+        CHECK_EQ(format_spec(Fraction(1, 3), "p"), "0.(3)");
+        CHECK_EQ(format_spec(Fraction(-7, 12), "p"), "-0.58(3)");
+        CHECK_EQ(format_spec(Fraction(1, 7), "p"), "0.(142857)");
+        CHECK_EQ(format_spec(Fraction(3, 8), "p"), "0.375");
+        CHECK_EQ(format_spec(Fraction(4, 2), "p"), "2");
+        CHECK_EQ(format_spec(Fraction(1, 97), ".5p"), "0.(01030...)");
+        CHECK_EQ(format_spec(Fraction(1, 1024), ".3p"), "0.000...");
+        CHECK_EQ(format_spec(Fraction(1, 6), ".1p"), "0.1(...)");
+    }
+
+    TEST_CASE("Invalid specs") {
+        CHECK_EQ(format_spec(Fraction(1, 2), "x"), "invalid");
+        CHECK_EQ(format_spec(Fraction(1, 2), ".3m"), "invalid");
+        CHECK_EQ(format_spec(Fraction(1, 2), "."), "invalid");
+        CHECK_EQ(format_spec(Fraction(1, 2), "ff"), "invalid");
+    }
+
+#if defined(__cpp_lib_format)
+    TEST_CASE("std::format") {
+        CHECK_EQ(std::format("{} and {:m}", Fraction(-7, 3), Fraction(-7, 3)), "-7/3 and -2 1/3");
+        const Fraction values[] = {Fraction(-7, 3), Fraction(1, 7), Fraction(-7, 12), Fraction(1, 1024), Fraction(4, 2)};
+        for (const string spec : {"", "r", "m", "f", ".5f", ".5", ".0f", "p", ".3p"})
+            for (const Fraction& value : values) {
+                Fraction argument = value;
+                CHECK_EQ(std::vformat("{:" + spec + "}", std::make_format_args(argument)), format_spec(value, spec));
+            }
+        for (const string spec : {"x", ".3m", ".", "ff"}) {
+            Fraction argument(1, 2);
+            CHECK_THROWS_AS(std::vformat("{:" + spec + "}", std::make_format_args(argument)), std::format_error);
+        }
+    }
+#endif
+}
+
+TEST_SUITE("CSV ingest") {
+    TEST_CASE("FractionColumn keeps numerators and denominators apart") {
+        FractionColumn column(vector<Fraction>{Fraction(2, 4), Fraction(-3, 1)});
+        column.push_back(Fraction(5, -10));
+        CHECK_EQ(column.size(), 3);
+        CHECK_EQ(column.getNumerators(), vector<int>{1, -3, -1});
+        CHECK_EQ(column.getDenominators(), vector<int>{2, 1, 2});
+        CHECK_EQ(column[2], Fraction(-1, 2));
+    }
+
+    TEST_CASE("Columns, header and error reports") {
+        CsvOptions options;
+        options.header = true;
+        CsvTable table = parse_csv("price , ratio\n1/2, 3 4\n\n-12.5,1/0\r\nx,2147483648\n7\n", options);
+
+        REQUIRE_EQ(table.columns.size(), 2);
+        CHECK_EQ(table.rows, 4);
+        CHECK_EQ(table.columns[0].name, "price");
+        CHECK_EQ(table.columns[1].name, "ratio");
+
+        const FractionColumn& prices = table.columns[0].values;
+        CHECK_EQ(prices[0], Fraction(1, 2));
+        CHECK_EQ(prices[1], Fraction(-25, 2));
+        CHECK_EQ(prices[2], Fraction());
+        CHECK_EQ(prices[3], Fraction(7, 1));
+        CHECK_EQ(table.columns[1].values[0], Fraction(3, 4));
+
+        const vector<CsvError>& price_errors = table.columns[0].errors;
+        REQUIRE_EQ(price_errors.size(), 1);
+        CHECK_EQ(price_errors[0].row, 2);
+        CHECK(price_errors[0].kind == CsvErrorKind::Malformed);
+
+        const vector<CsvError>& ratio_errors = table.columns[1].errors;
+        REQUIRE_EQ(ratio_errors.size(), 3);
+        CHECK(ratio_errors[0].kind == CsvErrorKind::ZeroDenominator);
+        CHECK(ratio_errors[1].kind == CsvErrorKind::OutOfRange);
+        CHECK_EQ(ratio_errors[2].row, 3);
+        CHECK(ratio_errors[2].kind == CsvErrorKind::MissingField);
+    }
+
+    TEST_CASE("Empty fields are malformed, not zero denominators") {
+        CsvTable table = parse_csv("1,2,3\n1,,3\n1,2,\n");
+        REQUIRE_EQ(table.columns.size(), 3);
+        CHECK_EQ(table.rows, 3);
+
+        const vector<CsvError>& middle_errors = table.columns[1].errors;
+        REQUIRE_EQ(middle_errors.size(), 1);
+        CHECK_EQ(middle_errors[0].row, 1);
+        CHECK(middle_errors[0].kind == CsvErrorKind::Malformed);
+
+        const vector<CsvError>& last_errors = table.columns[2].errors;
+        REQUIRE_EQ(last_errors.size(), 1);
+        CHECK_EQ(last_errors[0].row, 2);
+        CHECK(last_errors[0].kind == CsvErrorKind::Malformed);
+        CHECK_EQ(table.columns[0].errors.size(), 0);
+    }
+
+    TEST_CASE("TSV file split across threads") {
+        const char* path = "csv_ingest_test.tsv";
+        const int rows = 200000;
+        {
+            ofstream file(path);
+            for (int row = 0; row < rows; row++)
+                file << row << "/7\t" << (row % 50 == 0 ? "bad" : "1 3") << "\n";
+        }
+
+        CsvOptions options;
+        options.threads = 4;
+        CsvTable table = load_csv(path, options);
+        remove(path);
+
+        REQUIRE_EQ(table.columns.size(), 2);
+        CHECK_EQ(table.rows, rows);
+        CHECK_EQ(table.columns[0].values[rows - 1], Fraction(rows - 1, 7));
+        CHECK_EQ(table.columns[0].errors.size(), 0);
+        CHECK_EQ(table.columns[1].errors.size(), rows / 50);
+        CHECK_EQ(table.columns[1].errors.back().row, rows - 50);
+
+        CHECK_THROWS_AS(load_csv("no_such_file.csv"), runtime_error);
+    }
+}
+
+TEST_SUITE("Binary fraction files") {
+    TEST_CASE("Round trip through blocks and the dictionary") {
+        const char* path = "fraction_file_test.bin";
+        FractionColumn column;
+        for (int index = -5000; index < 5000; index++)
+            column.push_back(Fraction(index, 1 + (index & 7) * 25));
+        column.push_back(Fraction(numeric_limits<int>::min(), 1));
+        column.push_back(Fraction(numeric_limits<int>::max(), numeric_limits<int>::max() - 1));
+        write_fraction_file(path, column, 1000);
+
+        FractionFileReader reader(path);
+        CHECK_EQ(reader.size(), column.size());
+        CHECK_EQ(reader.blockCount(), 11);
+        CHECK_EQ(reader.blockLength(10), 2);
+
+        FractionColumn loaded = reader.read();
+        CHECK_EQ(loaded.getNumerators(), column.getNumerators());
+        CHECK_EQ(loaded.getDenominators(), column.getDenominators());
+
+        size_t index = 0;
+        bool same = true;
+        reader.forEach([&](const Fraction& value) {
+            same = same && value == column[index++];
+        });
+        CHECK(same);
+        CHECK_EQ(index, column.size());
+
+        int numerators[1000];
+        int denominators[1000];
+        CHECK_EQ(reader.decodeBlock(3, numerators, denominators), 1000);
+        CHECK_EQ(Fraction(numerators[0], denominators[0]), column[3000]);
+        remove(path);
+    }
+
+    TEST_CASE("Empty columns and single denominators") {
+        const char* path = "fraction_file_test.bin";
+        write_fraction_file(path, FractionColumn());
+        CHECK_EQ(FractionFileReader(path).size(), 0);
+
+        FractionColumn integers(vector<Fraction>{Fraction(1, 1), Fraction(-2, 1), Fraction(3, 1)});
+        write_fraction_file(path, integers);
+        CHECK_EQ(FractionFileReader(path).read().getNumerators(), integers.getNumerators());
+        remove(path);
+    }
+
+    TEST_CASE("Rejects files that aren't fraction files") {
+        const char* path = "fraction_file_test.bin";
+        {
+            ofstream file(path);
+            file << "1/2,3/4\n";
+        }
+        CHECK_THROWS_AS(FractionFileReader reader(path), runtime_error);
+        CHECK_THROWS_AS(FractionFileReader reader("no_such_file.bin"), runtime_error);
+        remove(path);
+    }
+
+    TEST_CASE("Header sizes are bounded by the file") {
+        const char* path = "fraction_file_test.bin";
+        FractionColumn column(vector<Fraction>{Fraction(1, 2), Fraction(3, 4), Fraction(5, 6)});
+        auto patched = [&](size_t offset, uint32_t low, uint32_t high) {
+            write_fraction_file(path, column);
+            fstream file(path, ios::in | ios::out | ios::binary);
+            file.seekp(streamoff(offset));
+            uint32_t words[] = {low, high};
+            file.write(reinterpret_cast<const char*>(words), offset == 16 ? 8 : 4);
+        };
+
+        // One block of three values, written with a huge block size: the
+        // buffers are sized by the values, not by the header.
+        patched(12, 0xFFFFFFFF, 0);
+        FractionFileReader reader(path);
+        CHECK_EQ(reader.blockSize(), 3);
+        CHECK_EQ(reader.read().getNumerators(), column.getNumerators());
+
+        // A count far past the file, where count + block_size - 1 wraps.
+        patched(16, 0xFFFFFFFF, 0xFFFFFFFF);
+        CHECK_THROWS_AS(FractionFileReader corrupt(path), runtime_error);
+        // Still one block, but more values than its bytes can hold.
+        patched(16, 20, 0);
+        CHECK_THROWS_AS(FractionFileReader corrupt(path), runtime_error);
+        remove(path);
+    }
+
+    TEST_CASE("Writers and readers only take fractions in lowest terms") {
+        const char* path = "fraction_file_test.bin";
+        const size_t uint32_max = numeric_limits<uint32_t>::max();
+        CHECK_THROWS_AS(FractionFileWriter(path, {1}, 10, uint32_max + 1), invalid_argument);
+        CHECK_THROWS_AS(FractionFileWriter(path, {1}, (uint32_max + 1) * 2, 2), invalid_argument);
+        CHECK_THROWS_AS(FractionFileWriter(path, {0, 1}, 10), invalid_argument);
+        CHECK_THROWS_AS(FractionFileWriter(path, {-3, 1}, 10), invalid_argument);
+        {
+            FractionFileWriter writer(path, {1, 4}, 10);
+            CHECK_THROWS_AS(writer.push_back(2, 4), invalid_argument);
+            CHECK_THROWS_AS(writer.push_back(0, 4), invalid_argument);
+        }
+
+        // 1/2 with its numerator patched to 2: the block starts after the
+        // header, one dictionary entry and two offsets, with its index width.
+        write_fraction_file(path, FractionColumn(vector<Fraction>{Fraction(1, 2)}));
+        {
+            fstream file(path, ios::in | ios::out | ios::binary);
+            file.seekp(32 + 4 + 16 + 1);
+            file.put(char(zigzag_encode(2)));
+        }
+        FractionFileReader reader(path);
+        CHECK_THROWS_AS(reader.read(), runtime_error);
+        remove(path);
+    }
+}
+
+TEST_SUITE("Wire codec") {
+    TEST_CASE("Integers take one byte, small fractions two") {
+        uint8_t buffer[64];
+        FractionEncoder encoder;
+        Fraction values[] = {Fraction(3, 1), Fraction(-1, 2), Fraction(5, 7)};
+        EncodeResult result = encoder.encode(values, 3, buffer, buffer + sizeof(buffer));
+        CHECK_EQ(result.count, 3);
+        CHECK_EQ(result.ptr - buffer, 5);
+
+        Fraction decoded[3];
+        FractionDecoder decoder;
+        DecodeResult read = decoder.decode(buffer, result.ptr, decoded, 3);
+        CHECK_EQ(read.ec, errc());
+        CHECK_EQ(read.count, 3);
+        CHECK_EQ(read.ptr, result.ptr);
+        CHECK_EQ(decoded[1], Fraction(-1, 2));
+        CHECK_EQ(decoded[2], Fraction(5, 7));
+    }
+
+    TEST_CASE("Delta mode round trip, extremes included") {
+        vector<Fraction> values;
+        for (int index = 0; index < 100; index++)
+            values.emplace_back(index * 3 + 1, 1000);
+        values.emplace_back(numeric_limits<int>::min(), 1);
+        values.emplace_back(numeric_limits<int>::max(), numeric_limits<int>::max() - 1);
+        values.emplace_back(-7, 9);
+
+        for (bool delta : {false, true}) {
+            vector<uint8_t> buffer(values.size() * max_encoded_fraction_size);
+            FractionEncoder encoder(delta);
+            EncodeResult result = encoder.encode(values.data(), values.size(), buffer.data(), buffer.data() + buffer.size());
+            CHECK_EQ(result.count, values.size());
+
+            FractionColumn column;
+            FractionDecoder decoder(delta);
+            DecodeResult read = decoder.decode(buffer.data(), result.ptr, column, values.size());
+            CHECK_EQ(read.count, values.size());
+            CHECK_EQ(column.getNumerators(), FractionColumn(values).getNumerators());
+            CHECK_EQ(column.getDenominators(), FractionColumn(values).getDenominators());
+        }
+    }
+
+    TEST_CASE("Streaming across small buffers") {
+        FractionColumn values;
+        for (int index = 1; index <= 500; index++)
+            values.push_back(Fraction(index * 7919, index % 13 + 1));
+
+        // Encode through a 7 byte window
+        vector<uint8_t> stream;
+        FractionEncoder encoder(true);
+        for (size_t done = 0; done < values.size();) {
+            uint8_t window[7];
+            EncodeResult result = encoder.encode(values, done, window, window + sizeof(window));
+            REQUIRE_GT(result.count, 0);
+            stream.insert(stream.end(), window, result.ptr);
+            done += result.count;
+        }
+
+        // Decode feeding 3 bytes at a time
+        FractionColumn decoded;
+        FractionDecoder decoder(true);
+        const uint8_t* consumed = stream.data();
+        for (size_t fed = 0; fed < stream.size();) {
+            fed = min(stream.size(), fed + 3);
+            DecodeResult result = decoder.decode(consumed, stream.data() + fed, decoded, values.size());
+            CHECK_EQ(result.ec, errc());
+            consumed = result.ptr;
+        }
+        CHECK_EQ(decoded.getNumerators(), values.getNumerators());
+        CHECK_EQ(decoded.getDenominators(), values.getDenominators());
+    }
+
+    TEST_CASE("Corrupt input") {
+        const uint8_t bad_varint[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+        Fraction value;
+        FractionDecoder decoder;
+        CHECK_EQ(decoder.decode(bad_varint, bad_varint + sizeof(bad_varint), &value, 1).ec, errc::illegal_byte_sequence);
+
+        // Numerator 2^32 doesn't fit in an int
+        const uint8_t too_big[] = {0x81, 0x80, 0x80, 0x80, 0x40};
+        DecodeResult result = decoder.decode(too_big, too_big + sizeof(too_big), &value, 1);
+        CHECK_EQ(result.ec, errc::illegal_byte_sequence);
+        CHECK_EQ(result.count, 0);
+
+        // A denominator delta of 2^63 - 1, which overflows when added.
+        uint8_t huge_delta[2 * max_varint_size];
+        uint8_t* end = write_varint(write_varint(huge_delta, 0), zigzag_encode(numeric_limits<int64_t>::max()));
+        FractionDecoder delta_decoder(true);
+        result = delta_decoder.decode(huge_delta, end, &value, 1);
+        CHECK_EQ(result.ec, errc::illegal_byte_sequence);
+        CHECK_EQ(result.count, 0);
+    }
+}
+
+// Exact order, independent of Fraction::operator<.
+static bool exact_less(const Fraction& lhs, const Fraction& rhs) {
+    return (long long)lhs.getNumerator() * rhs.getDenominator() < (long long)rhs.getNumerator() * lhs.getDenominator();
+}
+
+static vector<Fraction> key_samples() {
+    const int int_max = numeric_limits<int>::max();
+    const int int_min = numeric_limits<int>::min();
+    vector<Fraction> values;
+    for (int numerator = -13; numerator <= 13; numerator++)
+        for (int denominator = 1; denominator <= 13; denominator++)
+            values.emplace_back(numerator, denominator);
+    for (int numerator : {int_min, int_min + 1, -int_max / 2, -1, 1, int_max / 3, int_max - 1, int_max})
+        for (int denominator : {1, 2, 3, 7, 1000, int_max / 2, int_max - 1, int_max})
+            values.emplace_back(numerator, denominator);
+    values.emplace_back(1836311903, 1134903170); // ratio of Fibonacci numbers, the longest continued fraction
+    values.emplace_back(-1134903170, 1836311903);
+    values.emplace_back(355, 113);
+    sort(values.begin(), values.end(), exact_less);
+    return values;
+}
+
+static vector<uint8_t> byte_key(const Fraction& value) {
+    uint8_t buffer[fraction_key_max];
+    return vector<uint8_t>(buffer, write_fraction_key(buffer, value));
+}
+
+TEST_SUITE("Sort keys") {
+    TEST_CASE("Variable length keys sort like the values and round trip") {
+        vector<Fraction> values = key_samples();
+        for (size_t index = 0; index < values.size(); index++) {
+            vector<uint8_t> key = byte_key(values[index]);
+            CHECK_LE(key.size(), fraction_key_max);
+
+            Fraction decoded;
+            CHECK_EQ(read_fraction_key(key.data(), key.data() + key.size(), decoded), key.data() + key.size());
+            CHECK_EQ(decoded, values[index]);
+
+            if (index > 0) {
+                vector<uint8_t> previous = byte_key(values[index - 1]);
+                bool equal = values[index - 1] == values[index];
+                CHECK_EQ(previous == key, equal);
+                if (!equal)
+                    CHECK(lexicographical_compare(previous.begin(), previous.end(), key.begin(), key.end()));
+            }
+        }
+    }
+
+    TEST_CASE("Simple values have short keys") {
+        CHECK_EQ(byte_key(Fraction(0, 1)).size(), 2);
+        CHECK_EQ(byte_key(Fraction(1, 2)).size(), 3);
+        CHECK_EQ(byte_key(Fraction(355, 113)).size(), 5);
+        CHECK_EQ(byte_key(Fraction(1836311903, 1134903170)).size(), 46);
+    }
+
+    TEST_CASE("Malformed variable length keys") {
+        vector<uint8_t> key = byte_key(Fraction(-22, 7));
+        Fraction value;
+        CHECK_EQ(read_fraction_key(key.data(), key.data() + key.size() - 1, value), nullptr);
+
+        // [0; 2, 1] is 1/3 written with a trailing 1.
+        const uint8_t non_canonical[] = {0x80, 0xFD, 0x01, 0x00};
+        CHECK_EQ(read_fraction_key(non_canonical, non_canonical + sizeof(non_canonical), value), nullptr);
+        const uint8_t too_long[] = {0x85, 1, 0, 0, 0, 0, 0xFF};
+        CHECK_EQ(read_fraction_key(too_long, too_long + sizeof(too_long), value), nullptr);
+    }
+
+    TEST_CASE("128 bit keys for Fraction") {
+        vector<Fraction> values = key_samples();
+        for (size_t index = 0; index < values.size(); index++) {
+            unsigned __int128 key = fraction_key128(values[index]);
+            CHECK_EQ(fraction_from_key128(key), values[index]);
+            if (index > 0 && values[index - 1] != values[index]) {
+                CHECK(fraction_key128(values[index - 1]) < key);
+
+                uint8_t previous_bytes[16];
+                uint8_t bytes[16];
+                write_key_bytes(previous_bytes, fraction_key128(values[index - 1]));
+                write_key_bytes(bytes, key);
+                CHECK_LT(memcmp(previous_bytes, bytes, 16), 0);
+            }
+        }
+        // Keys between two adjacent values decode to nothing that fits.
+        CHECK_THROWS_AS(fraction_from_key128(fraction_key128(Fraction(1, 3)) + 1), overflow_error);
+        // Just below 1/2's key: 1/2 is on the closed end of the key's interval,
+        // not in it.
+        const unsigned __int128 sign_bit = static_cast<unsigned __int128>(1) << 127;
+        CHECK_THROWS_AS(fraction_from_key128(((static_cast<unsigned __int128>(1) << 61) - 1) ^ sign_bit), overflow_error);
+        CHECK_THROWS_AS(fraction64_from_key128(((static_cast<unsigned __int128>(1) << 63) - 1) ^ sign_bit), overflow_error);
+        CHECK_THROWS_AS(fraction32_from_key64(((uint64_t(1) << 31) - 1) ^ (uint64_t(1) << 63)), overflow_error);
+    }
+
+    TEST_CASE("Keys for the packed types") {
+        const uint32_t den_max = numeric_limits<uint32_t>::max();
+        const int32_t num_max = numeric_limits<int32_t>::max();
+        Fraction64 close[] = {Fraction64(1, den_max), Fraction64(1, den_max - 1), Fraction64(num_max - 1, den_max - 2),
+                              Fraction64(num_max, den_max), Fraction64(num_max, den_max - 2), Fraction64(num_max, 1)};
+        sort(begin(close), end(close));
+        for (size_t index = 0; index < 6; index++) {
+            CHECK_EQ(fraction64_from_key128(fraction_key128(close[index])), close[index]);
+            if (index > 0)
+                CHECK_LT(fraction_key128(close[index - 1]), fraction_key128(close[index]));
+        }
+        CHECK_LT(fraction_key128(-close[1]), fraction_key128(-close[0]));
+
+        vector<Fraction32> small;
+        for (int numerator : {-32768, -1000, -1, 0, 1, 999, 32767})
+            for (int denominator : {1, 3, 255, 65534, 65535})
+                small.emplace_back(numerator, denominator);
+        sort(small.begin(), small.end());
+        for (size_t index = 0; index < small.size(); index++) {
+            CHECK_EQ(fraction32_from_key64(fraction_key64(small[index])), small[index]);
+            if (index > 0)
+                CHECK_EQ(fraction_key64(small[index - 1]) < fraction_key64(small[index]), small[index - 1] < small[index]);
+        }
+    }
+}
+
+// Deterministic values of every size, with duplicates and values closer than 2^-30.
+static vector<Fraction> sort_samples(size_t count) {
+    const int int_max = numeric_limits<int>::max();
+    vector<Fraction> values;
+    uint64_t state = 12345;
+    for (size_t index = 0; index < count; index++) {
+        next_random(state);
+        int bits = int(state >> 59) + 1;
+        int numerator = int((state >> 20) & ((1ULL << bits) - 1)) - int((state >> 8) & 0xFF);
+        int denominator = int((state >> 30) % uint64_t(int_max - 1)) % (1 << min(bits, 30)) + 1;
+        switch (index % 7) {
+            case 0:
+                values.emplace_back(1, int_max - int(index % 50));
+                break;
+            case 1:
+                values.emplace_back(int(index % 11), 3);
+                break;
+            default:
+                values.emplace_back(state & 0x1000 ? -numerator : numerator, denominator);
+        }
+    }
+    return values;
+}
+
+TEST_SUITE("Sorting") {
+    TEST_CASE("Radix sort agrees with an exact comparison sort") {
+        vector<Fraction> values = sort_samples(20000);
+        vector<Fraction> expected = values;
+        stable_sort(expected.begin(), expected.end(), exact_less);
+
+        vector<Fraction> sorted = values;
+        radix_sort(sorted);
+        CHECK(sorted == expected);
+
+        FractionColumn column(values);
+        radix_sort(column);
+        CHECK_EQ(column.getNumerators(), FractionColumn(expected).getNumerators());
+        CHECK_EQ(column.getDenominators(), FractionColumn(expected).getDenominators());
+
+        vector<Fraction> empty;
+        radix_sort(empty);
+        CHECK(empty.empty());
+    }
+
+    TEST_CASE("Parallel sort") {
+        vector<Fraction> values = sort_samples(300000);
+        vector<Fraction> expected = values;
+        radix_sort(expected);
+        CHECK(is_sorted(expected.begin(), expected.end(), exact_less));
+
+        for (unsigned threads : {1U, 3U, 4U}) {
+            vector<Fraction> sorted = values;
+            parallel_sort(sorted, threads);
+            CHECK(sorted == expected);
+
+            FractionColumn column(values);
+            parallel_sort(column, threads);
+            CHECK_EQ(column.getNumerators(), FractionColumn(expected).getNumerators());
+        }
+    }
+
+    TEST_CASE("Sorted order is stable") {
+        FractionColumn column;
+        for (int index = 0; index < 1000; index++)
+            column.push_back(Fraction(index % 10, 10 - index % 3));
+        vector<size_t> order = sorted_order(column);
+        REQUIRE_EQ(order.size(), column.size());
+        for (size_t index = 1; index < order.size(); index++) {
+            Fraction previous = column[order[index - 1]];
+            Fraction current = column[order[index]];
+            CHECK_FALSE(exact_less(current, previous));
+            if (previous == current)
+                CHECK_LT(order[index - 1], order[index]);
+        }
+    }
+}
+
+TEST_SUITE("External sort") {
+    TEST_CASE("Streaming writer with fewer values than reserved") {
+        const char* path = "fraction_writer_test.bin";
+        {
+            FractionFileWriter writer(path, {7, 1, 3}, 100, 4);
+            for (int index = 0; index < 10; index++)
+                writer.push_back(Fraction(index, 7));
+            writer.push_back(2, 1);
+            CHECK_THROWS_AS(writer.push_back(1, 5), invalid_argument);
+            CHECK_EQ(writer.size(), 11);
+            writer.finish();
+        }
+        FractionFileReader reader(path);
+        CHECK_EQ(reader.size(), 11);
+        CHECK_EQ(reader.denominators(), vector<int>{1, 3, 7});
+        FractionColumn column = reader.read();
+        CHECK_EQ(column[3], Fraction(3, 7));
+        CHECK_EQ(column[7], Fraction(1, 1));
+        CHECK_EQ(column[10], Fraction(2, 1));
+        remove(path);
+    }
+
+    TEST_CASE("A writer that isn't finished leaves no file") {
+        const char* path = "fraction_writer_test.bin";
+        CHECK_THROWS_AS(([path] {
+                            FractionFileWriter writer(path, {1, 3}, 100, 4);
+                            for (int index = 0; index < 10; index++)
+                                writer.push_back(Fraction(index, 3));
+                            throw runtime_error("merge failed");
+                        }()),
+                        runtime_error);
+        CHECK_EQ(fopen(path, "rb"), nullptr);
+    }
+
+    TEST_CASE("A merge that fails leaves no output file") {
+        if (access("/dev/full", W_OK) != 0) {
+            MESSAGE("no /dev/full, skipped");
+            return;
+        }
+        const char* input = "external_sort_input.bin";
+        // Writes to /dev/full fail, so the merge fails when it finishes
+        // the output; the link, not /dev/full, is what gets removed.
+        const char* output = "external_sort_full.bin";
+        write_fraction_file(input, FractionColumn(sort_samples(20000)), 1000);
+        remove(output);
+        REQUIRE_EQ(symlink("/dev/full", output), 0);
+
+        ExternalSortOptions options;
+        options.memory_budget = 4000 * external_sort_bytes_per_value;
+        options.block_size = 512;
+        CHECK_THROWS_AS(external_sort(input, output, options), runtime_error);
+        struct stat status;
+        CHECK_NE(lstat(output, &status), 0);
+        CHECK_EQ(fopen("external_sort_full.bin.run0", "rb"), nullptr);
+        CHECK_EQ(stat("/dev/full", &status), 0);
+
+        remove(input);
+        remove(output);
+    }
+
+    TEST_CASE("Runs are merged into a sorted file") {
+        const char* input = "external_sort_input.bin";
+        const char* output = "external_sort_output.bin";
+        vector<Fraction> values = sort_samples(50000);
+        write_fraction_file(input, FractionColumn(values), 1000);
+        vector<Fraction> expected = values;
+        radix_sort(expected);
+
+        ExternalSortOptions options;
+        options.memory_budget = 4000 * external_sort_bytes_per_value;
+        options.block_size = 512;
+        ExternalSortResult result = external_sort(input, output, options);
+        CHECK_EQ(result.input_count, values.size());
+        CHECK_EQ(result.output_count, values.size());
+        CHECK_EQ(result.runs, 13);
+        FractionColumn sorted = FractionFileReader(output).read();
+        CHECK_EQ(sorted.getNumerators(), FractionColumn(expected).getNumerators());
+        CHECK_EQ(sorted.getDenominators(), FractionColumn(expected).getDenominators());
+
+        // The runs are gone.
+        CHECK_EQ(fopen("external_sort_output.bin.run0", "rb"), nullptr);
+
+        options.dedupe = true;
+        result = external_sort(input, output, options);
+        expected.erase(unique(expected.begin(), expected.end()), expected.end());
+        CHECK_EQ(result.output_count, expected.size());
+        sorted = FractionFileReader(output).read();
+        CHECK_EQ(sorted.getNumerators(), FractionColumn(expected).getNumerators());
+
+        // Small enough to sort in memory.
+        options.memory_budget = size_t(1) << 30;
+        result = external_sort(input, output, options);
+        CHECK_EQ(result.runs, 1);
+        CHECK_EQ(FractionFileReader(output).read().getNumerators(), FractionColumn(expected).getNumerators());
+
+        remove(input);
+        remove(output);
+    }
+
+    TEST_CASE("The merged dictionary is deduplicated and kept within the budget") {
+        const char* input = "external_sort_input.bin";
+        const char* output = "external_sort_output.bin";
+        ExternalSortOptions options;
+        options.memory_budget = 4000 * external_sort_bytes_per_value;
+        options.block_size = 512;
+
+        // Every run has the same few denominators; the output has each once.
+        vector<Fraction> few;
+        for (int index = 0; index < 20000; index++)
+            few.emplace_back(index % 1000 - 500, 1 + index % 7 * 2);
+        write_fraction_file(input, FractionColumn(few), 1000);
+        CHECK_GT(external_sort(input, output, options).runs, 1);
+        CHECK_EQ(FractionFileReader(output).denominators(), vector<int>{1, 3, 5, 7, 9, 11, 13});
+
+        // Too many distinct ones to hold: stored raw, and still sorted.
+        vector<Fraction> many = sort_samples(50000);
+        write_fraction_file(input, FractionColumn(many), 1000);
+        CHECK_GT(external_sort(input, output, options).runs, 1);
+        FractionFileReader reader(output);
+        CHECK(reader.denominators().empty());
+        radix_sort(many);
+        CHECK_EQ(reader.read().getDenominators(), FractionColumn(many).getDenominators());
+
+        // Without a dictionary, a writer takes any positive denominator.
+        {
+            FractionFileWriter writer(output, {}, 3, 2);
+            writer.push_back(1, 3);
+            writer.push_back(-5, numeric_limits<int>::max());
+            CHECK_THROWS_AS(writer.push_back(1, 0), invalid_argument);
+            writer.push_back(7, 1);
+            writer.finish();
+        }
+        CHECK_EQ(FractionFileReader(output).read().getDenominators(), vector<int>{3, numeric_limits<int>::max(), 1});
+
+        remove(input);
+        remove(output);
+    }
+}
+
+TEST_SUITE("Hashing") {
+    TEST_CASE("Equal values hash equally") {
+        CHECK_EQ(hash<Fraction>()(Fraction(2, 4)), hash<Fraction>()(Fraction(-1, -2)));
+        CHECK_EQ(hash<Fraction>()(Fraction(0, 5)), hash<Fraction>()(Fraction(0, 1)));
+        CHECK_NE(hash<Fraction>()(Fraction(1, 2)), hash<Fraction>()(Fraction(2, 1)));
+        CHECK_NE(hash_fraction(Fraction(1, 2), 1), hash_fraction(Fraction(1, 2), 2));
+
+        unordered_map<Fraction, int> counts;
+        for (int index = 1; index <= 12; index++)
+            counts[Fraction(1, 1 + index % 3)]++;
+        CHECK_EQ(counts.size(), 3);
+        CHECK_EQ(counts[Fraction(2, 6)], 4);
+    }
+
+    TEST_CASE("A grid of k/100 spreads over the buckets") {
+        const size_t count = 100000;
+        const size_t buckets = 1 << 14;
+        vector<size_t> load(buckets);
+        for (size_t index = 0; index < count; index++)
+            load[hash<Fraction>()(Fraction(int(index), 100)) % buckets]++;
+        // About 6.1 per bucket; a weak hash on this grid leaves most buckets empty.
+        CHECK_LT(*max_element(load.begin(), load.end()), 25);
+        CHECK_LT(count_if(load.begin(), load.end(), [](size_t size) { return size == 0; }), 100);
+    }
+
+    TEST_CASE("Batch hashing matches one at a time") {
+        FractionColumn column(sort_samples(1000));
+        vector<uint64_t> hashes = hash_fractions(column, 7);
+        REQUIRE_EQ(hashes.size(), column.size());
+        for (size_t index = 0; index < column.size(); index++)
+            CHECK_EQ(hashes[index], hash_fraction(column[index], 7));
+
+        unordered_set<uint64_t> distinct(hashes.begin(), hashes.end());
+        unordered_set<Fraction> values;
+        for (size_t index = 0; index < column.size(); index++)
+            values.insert(column[index]);
+        CHECK_EQ(distinct.size(), values.size());
+    }
+}
+
+// Passes with and without FRACTION_STATS; make stats runs it with.
+TEST_SUITE("Stats") {
+    TEST_CASE("Counts constructions, reductions and gcd steps") {
+        fraction_stats_reset();
+        Fraction value(6, 4);
+        Fraction fibonacci(46368, 28657);
+        FractionStats stats = fraction_stats_snapshot();
+        if (!fraction_stats_enabled()) {
+            CHECK_EQ(stats.constructions, 0);
+            CHECK_EQ(stats.reductions, 0);
+            return;
+        }
+        CHECK_EQ(stats.constructions, 2);
+        CHECK_EQ(stats.reductions, 2);
+        CHECK_EQ(stats.already_reduced, 1);
+        CHECK_EQ(stats.gcd_iterations[2], 1);       // 6 % 4, 4 % 2
+        CHECK_EQ(stats.gcd_iterations[22], 1);      // consecutive Fibonacci numbers, the longest
+        CHECK_EQ(stats.exceptions(), 0);
+
+        fraction_stats_reset();
+        CHECK_EQ(fraction_stats_snapshot().constructions, 0);
+        CHECK_EQ((value * Fraction(0, 1)).getNumerator(), 0);
+        stats = fraction_stats_snapshot();
+        CHECK_EQ(stats.fast_paths, 1);
+        CHECK_EQ(stats.slow_paths, 1);
+    }
+
+    TEST_CASE("Counts exceptions by type") {
+        fraction_stats_reset();
+        CHECK_THROWS_AS(Fraction(1, 0), invalid_argument);
+        CHECK_THROWS_AS(Fraction(numeric_limits<int>::max(), 1) * Fraction(2, 1), overflow_error);
+        CHECK_THROWS_AS(Fraction(1, 2) / Fraction(0, 1), runtime_error);
+        FractionStats stats = fraction_stats_snapshot();
+        if (!fraction_stats_enabled()) {
+            CHECK_EQ(stats.exceptions(), 0);
+            return;
+        }
+        CHECK_EQ(stats.invalid_arguments, 1);
+        CHECK_EQ(stats.overflow_errors, 1);
+        CHECK_EQ(stats.runtime_errors, 1);
+    }
+
+    TEST_CASE("Counts the filtered comparisons that needed the exact fallback") {
+        fraction_stats_reset();
+        CHECK(Fraction128::filteredLess(Fraction128(1, 3), Fraction128(1, 2)));
+        CHECK(Fraction128::filteredLess(Fraction128(-5, 7), Fraction128(5, 7)));
+        CHECK(Fraction128::filteredLess(Fraction128(numeric_limits<int64_t>::max() - 1, numeric_limits<uint64_t>::max()),
+                                        Fraction128(numeric_limits<int64_t>::max(), numeric_limits<uint64_t>::max())));
+        FractionStats stats = fraction_stats_snapshot();
+        if (!fraction_stats_enabled()) {
+            CHECK_EQ(stats.exactComparisonRate(), 0);
+            return;
+        }
+        CHECK_EQ(stats.filtered_comparisons, 2);
+        CHECK_EQ(stats.exact_comparisons, 1);
+        CHECK_EQ(stats.exactComparisonRate(), doctest::Approx(1.0 / 3));
+    }
+
+    TEST_CASE("Threads that exited still count") {
+        fraction_stats_reset();
+        vector<thread> threads;
+        for (int thread_index = 0; thread_index < 4; thread_index++)
+            threads.emplace_back([] {
+                for (int index = 1; index <= 100; index++)
+                    Fraction value(index, 7);
+            });
+        for (thread& worker : threads)
+            worker.join();
+        CHECK_EQ(fraction_stats_snapshot().constructions, fraction_stats_enabled() ? 400 : 0);
+    }
+}
+
+TEST_SUITE("Reference") {
+    const int int_max = numeric_limits<int>::max();
+    const int int_min = numeric_limits<int>::min();
+
+    TEST_CASE("The reference follows Fraction's overflow rules") {
+        ReferenceResult sum = reference_arithmetic('+', Fraction(1, 6), Fraction(1, 3));
+        CHECK_FALSE(sum.overflow);
+        CHECK_EQ(sum.numerator, 1);
+        CHECK_EQ(sum.denominator, 2);
+        // 65536 * 65536 overflows even though the reduced sum would fit.
+        CHECK(reference_arithmetic('+', Fraction(1, 65536), Fraction(1, 65536)).overflow);
+        CHECK(reference_arithmetic('/', Fraction(int_min, 1), Fraction(-1, 1)).overflow);
+        CHECK(reference_fraction(int_min, -1).overflow);
+        CHECK_EQ(reference_fraction(int_min, int_min).numerator, 1);
+        CHECK_EQ(reference_compare(Fraction(17, 8388608), Fraction(13195, 16777216)), -1);
+        CHECK_EQ(reference_compare(Fraction(2, 4), Fraction(1, 2)), 0);
+    }
+
+    // Each of these disagreed with the reference before fraction_validate
+    // found them.
+    TEST_CASE("Fraction agrees with the reference at the edges") {
+        CHECK(Fraction(17, 8388608) < Fraction(13195, 16777216));
+        CHECK_FALSE(Fraction(int_max, 1) < Fraction(int_min, 1));
+        CHECK_THROWS_AS(Fraction(1 << 30, 1) * Fraction(-4, 1), overflow_error);
+        CHECK_THROWS_AS(Fraction(-(1 << 30), 1) * Fraction(4, 1), overflow_error);
+        CHECK_THROWS_AS(-Fraction(int_min, 1), overflow_error);
+        CHECK_THROWS_AS(Fraction(int_min, -1), overflow_error);
+        CHECK_EQ(Fraction(int_min, int_max), Fraction(int_min, int_max));
+        CHECK_EQ(Fraction(int_min, int_min), Fraction(1, 1));
+        CHECK_EQ(Fraction(int_min, 2).getNumerator(), -(1 << 30));
+    }
+
+    TEST_CASE("Operators match the reference on random operands") {
+        uint64_t state = 2023;
+        auto next = [&state] {
+            next_random(state);
+            return int(uint32_t(state >> 32)) >> (state >> 27 & 15);
+        };
+        for (int round = 0; round < 20000; round++) {
+            int lhs_den = next(), rhs_den = next();
+            Fraction lhs(next(), lhs_den == 0 ? 1 : lhs_den);
+            Fraction rhs(next(), rhs_den == 0 ? 1 : rhs_den);
+            CHECK_EQ(lhs < rhs, reference_compare(lhs, rhs) < 0);
+            CHECK_EQ(lhs == rhs, reference_compare(lhs, rhs) == 0);
+            for (char operation : {'+', '-', '*', '/'}) {
+                if (operation == '/' && rhs.getNumerator() == 0)
+                    continue;
+                ReferenceResult expected = reference_arithmetic(operation, lhs, rhs);
+                try {
+                    Fraction result = operation == '+' ? lhs + rhs : operation == '-' ? lhs - rhs
+                                    : operation == '*' ? lhs * rhs : lhs / rhs;
+                    REQUIRE_FALSE(expected.overflow);
+                    CHECK_EQ(result.getNumerator(), expected.numerator);
+                    CHECK_EQ(result.getDenominator(), expected.denominator);
+                }
+                catch (const overflow_error&) {
+                    CHECK(expected.overflow);
+                }
+            }
+        }
+    }
+}
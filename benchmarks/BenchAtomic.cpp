@@ -0,0 +1,123 @@
+/**
+ * Contention benchmark: AtomicFraction::fetch_add and ShardedAccumulator::add
+ * against a Fraction behind a mutex, with the operands of each workload
+ * picked with --workload (see BenchWorkloads.hpp).
+ *
+ * Each thread adds an operand and then its negation, so the total stays
+ * near zero whatever the workload. The operands other threads have
+ * outstanding can still make an add overflow; those are caught, skipped and
+ * counted, and count as done. Without overflows the totals must end at zero.
+ *
+ * Usage: ./bench_atomic [operations per thread] [--workload NAME|all]... [--seed N]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "AtomicFraction.hpp"
+#include "BenchWorkloads.hpp"
+#include "ShardedAccumulator.hpp"
+
+using namespace ariel;
+
+static const size_t table_size = 1024;
+static const size_t mask = table_size - 1;
+
+struct LockedFraction {
+    mutex lock;
+    Fraction value;
+
+    void add(const Fraction& operand) {
+        lock_guard<mutex> guard(lock);
+        value = value + operand;
+    }
+};
+
+// Runs add(operand) operations times on each of the given number of
+// threads, alternating operands and their negations; returns ns per
+// operation and counts the adds that overflowed.
+template <typename Add>
+double run_threads(unsigned threads, long operations, const bench::Workload& workload, const vector<Fraction>& negated,
+                   atomic<long>& overflows, Add add) {
+    vector<thread> workers;
+    auto start = chrono::steady_clock::now();
+    for (unsigned index = 0; index < threads; index++)
+        workers.emplace_back([&, index]() {
+            long skipped = 0;
+            bool pending = false;
+            for (long op = 0; op < operations; op++) {
+                size_t operand = (size_t(op / 2) + index * 97) & mask;
+                // Only take away what went in.
+                if (op % 2 == 1 && !pending)
+                    continue;
+                try {
+                    add(op % 2 == 0 ? workload.lhs[operand] : negated[operand]);
+                    pending = op % 2 == 0;
+                }
+                catch (const overflow_error&) {
+                    skipped++;
+                    pending = false;
+                }
+            }
+            overflows += skipped;
+        });
+    for (thread& worker : workers)
+        worker.join();
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / double(operations * threads);
+}
+
+int main(int argc, char** argv) {
+    vector<string> positional = bench::positional_args(argc, argv);
+    long operations = !positional.empty() ? atol(positional[0].c_str()) : 1000000;
+    uint64_t seed = bench::seed_from_args(argc, argv);
+    unsigned max_threads = max(1U, thread::hardware_concurrency());
+
+    cout << "AtomicFraction lock-free: " << (AtomicFraction::is_always_lock_free ? "yes" : "no") << endl;
+    cout << operations << " fetch_add per thread" << endl;
+    cout << setw(20) << "workload" << setw(8) << "threads" << setw(16) << "atomic ns/op" << setw(16)
+         << "sharded ns/op" << setw(16) << "mutex ns/op" << setw(10) << "speedup" << setw(12) << "overflows" << endl;
+
+    for (bench::Distribution distribution : bench::distributions_from_args(argc, argv)) {
+        bench::Workload workload = bench::make_workload(distribution, table_size, seed);
+        vector<Fraction> negated;
+        for (const Fraction& operand : workload.lhs)
+            negated.push_back(-operand);
+
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+            atomic<long> atomic_overflows(0), sharded_overflows(0), mutex_overflows(0);
+            AtomicFraction shared;
+            double atomic_ns = run_threads(threads, operations, workload, negated, atomic_overflows,
+                                           [&](const Fraction& operand) { shared.fetch_add(operand, memory_order_relaxed); });
+
+            ShardedAccumulator sharded;
+            double sharded_ns = run_threads(threads, operations, workload, negated, sharded_overflows,
+                                            [&](const Fraction& operand) { sharded.add(operand); });
+
+            LockedFraction locked;
+            double mutex_ns = run_threads(threads, operations, workload, negated, mutex_overflows,
+                                          [&](const Fraction& operand) { locked.add(operand); });
+
+            // Without overflows, every operand that went in came out again.
+            long overflows = atomic_overflows + sharded_overflows + mutex_overflows;
+            if (overflows == 0 && (shared.load() != Fraction() || sharded.snapshot() != Fraction() || locked.value != Fraction())) {
+                cerr << "Totals aren't zero: " << shared.load() << ", " << sharded.snapshot() << ", " << locked.value << endl;
+                return 1;
+            }
+
+            cout << setw(20) << bench::distribution_name(distribution) << setw(8) << threads << fixed
+                 << setprecision(1) << setw(16) << atomic_ns << setw(16) << sharded_ns << setw(16) << mutex_ns
+                 << setw(9) << setprecision(2) << mutex_ns / min(atomic_ns, sharded_ns) << "x"
+                 << setw(12) << overflows << endl;
+        }
+    }
+}
@@ -0,0 +1,99 @@
+/**
+ * Throughput of the binary fraction codec against the text path
+ * (operator<< to write, operator>> to read), on the values of each workload
+ * picked with --workload (see BenchWorkloads.hpp); by default
+ * shared-denominator, amounts in cents.
+ *
+ * Usage: ./bench_codec [number of values] [--workload NAME|all]... [--seed N]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "BenchWorkloads.hpp"
+#include "FractionCodec.hpp"
+
+using namespace ariel;
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void report(const string& name, size_t values, size_t bytes, double seconds) {
+    cout << setw(26) << left << name << right << fixed
+         << setw(10) << setprecision(2) << double(bytes) / double(values)
+         << setw(12) << setprecision(1) << seconds * 1e9 / double(values)
+         << setw(12) << setprecision(1) << double(bytes) / seconds / 1e6 << endl;
+}
+
+static void run(const string& name, const vector<Fraction>& values, bool delta) {
+    cout << name << ":" << endl;
+    cout << setw(26) << left << "path" << right << setw(10) << "bytes/val" << setw(12) << "ns/val" << setw(12) << "MB/s" << endl;
+
+    // Binary
+    vector<uint8_t> buffer(values.size() * max_encoded_fraction_size);
+    FractionEncoder encoder(delta);
+    auto start = chrono::steady_clock::now();
+    EncodeResult encoded = encoder.encode(values.data(), values.size(), buffer.data(), buffer.data() + buffer.size());
+    size_t bytes = size_t(encoded.ptr - buffer.data());
+    report("binary encode", values.size(), bytes, seconds_since(start));
+
+    FractionColumn column;
+    column.reserve(values.size());
+    FractionDecoder decoder(delta);
+    start = chrono::steady_clock::now();
+    DecodeResult decoded = decoder.decode(buffer.data(), encoded.ptr, column, values.size());
+    report("binary decode (column)", values.size(), bytes, seconds_since(start));
+    if (decoded.count != values.size() || column[values.size() / 2] != values[values.size() / 2]) {
+        cerr << "Round trip failed" << endl;
+        exit(1);
+    }
+
+    vector<Fraction> fractions(values.size());
+    decoder.reset();
+    start = chrono::steady_clock::now();
+    decoder.decode(buffer.data(), encoded.ptr, fractions.data(), fractions.size());
+    report("binary decode (Fraction)", values.size(), bytes, seconds_since(start));
+
+    // Text: operator<< writes "a/b", but operator>> reads "a b".
+    ostringstream output;
+    start = chrono::steady_clock::now();
+    for (const Fraction& value : values)
+        output << value << '\n';
+    report("text write (operator<<)", values.size(), output.str().size(), seconds_since(start));
+
+    ostringstream readable;
+    for (const Fraction& value : values)
+        readable << value.getNumerator() << ' ' << value.getDenominator() << '\n';
+    istringstream input(readable.str());
+    Fraction value;
+    start = chrono::steady_clock::now();
+    for (size_t index = 0; index < values.size(); index++)
+        input >> value;
+    report("text read (operator>>)", values.size(), readable.str().size(), seconds_since(start));
+    cout << endl;
+}
+
+int main(int argc, char** argv) {
+    vector<string> positional = bench::positional_args(argc, argv);
+    size_t count = !positional.empty() ? size_t(atol(positional[0].c_str())) : 1000000;
+    uint64_t seed = bench::seed_from_args(argc, argv);
+
+    for (bench::Distribution distribution :
+         bench::distributions_from_args(argc, argv, bench::Distribution::shared_denominator)) {
+        vector<Fraction> values = bench::make_workload(distribution, count, seed).lhs;
+        string name = bench::distribution_name(distribution);
+        run(name, values, false);
+
+        sort(values.begin(), values.end());
+        run(name + ", sorted, delta coded", values, true);
+    }
+}
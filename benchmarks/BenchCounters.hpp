@@ -0,0 +1,183 @@
+#pragma once
+
+/**
+ * Hardware performance counters through Linux perf_event_open(2), for the
+ * harness's --counters mode.
+ *
+ * Each counter is opened on its own, counting user space of this thread
+ * only, so one that the kernel, the CPU or a container doesn't offer only
+ * loses that column. Counters that had to share the PMU are scaled by the
+ * time they actually ran. Where none can be opened (no PMU in the VM,
+ * perf_event_paranoid, seccomp), the benchmarks still run and report time.
+ */
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace bench
+{
+    using namespace std;
+
+    struct CounterSpec {
+        string name;
+        uint32_t type;
+        uint64_t config;
+    };
+
+    // The divider-busy event is model specific; only the Intel cores whose
+    // event we know get it.
+    inline bool divider_event(uint64_t& config) {
+        ifstream cpuinfo("/proc/cpuinfo");
+        string vendor;
+        int family = 0, model = -1;
+        for (string line; getline(cpuinfo, line) && model < 0;) {
+            size_t colon = line.find(':');
+            if (colon == string::npos)
+                continue;
+            string value = line.substr(colon + 1);
+            if (line.compare(0, 9, "vendor_id") == 0)
+                vendor = value.substr(value.find_first_not_of(' '));
+            else if (line.compare(0, 10, "cpu family") == 0)
+                family = atoi(value.c_str());
+            else if (line.compare(0, 5, "model") == 0 && line.compare(0, 10, "model name") != 0)
+                model = atoi(value.c_str());
+        }
+        if (vendor != "GenuineIntel" || family != 6)
+            return false;
+        // Event, umask, cmask = 1: cycles with the divider busy.
+        auto raw = [](uint64_t event, uint64_t umask) { return event | umask << 8 | uint64_t(1) << 24; };
+        switch (model) {
+            case 0x4E: case 0x5E: case 0x55: case 0x8E: case 0x9E: case 0xA5: case 0xA6:
+                config = raw(0x14, 0x01);       // Skylake to Comet Lake: ARITH.DIVIDER_ACTIVE
+                return true;
+            case 0x6A: case 0x6C: case 0x7D: case 0x7E: case 0x8C: case 0x8D:
+                config = raw(0x14, 0x09);       // Ice Lake, Tiger Lake: ARITH.DIVIDER_ACTIVE
+                return true;
+            case 0x8F: case 0x97: case 0x9A: case 0xB7: case 0xBA: case 0xCF:
+                config = raw(0xB0, 0x09);       // Sapphire Rapids, Alder Lake, Raptor Lake: ARITH.DIV_ACTIVE
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    inline vector<CounterSpec> counter_specs() {
+        auto cache_miss = [](uint64_t cache) {
+            return cache | uint64_t(PERF_COUNT_HW_CACHE_OP_READ) << 8 | uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16;
+        };
+        vector<CounterSpec> specs = {
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"l1d-misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+            {"llc-misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+            {"divider-cycles", PERF_TYPE_RAW, 0},
+        };
+        return specs;
+    }
+
+    class Counters {
+        private:
+            struct Event {
+                string name;
+                int fd;
+                string error;       // why it isn't available
+            };
+            vector<Event> events;
+
+            static int open_event(uint32_t type, uint64_t config) {
+                perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = type;
+                attr.config = config;
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            }
+
+        public:
+            // names is "all" or a comma separated list of counter_specs() names.
+            explicit Counters(const string& names) {
+                for (const CounterSpec& spec : counter_specs()) {
+                    if (names != "all" && ("," + names + ",").find("," + spec.name + ",") == string::npos)
+                        continue;
+                    Event event{spec.name, -1, ""};
+                    uint64_t config = spec.config;
+                    if (spec.type == PERF_TYPE_RAW && !divider_event(config))
+                        event.error = "no known event for this CPU";
+                    else if ((event.fd = open_event(spec.type, config)) < 0)
+                        event.error = strerror(errno);
+                    events.push_back(event);
+                }
+            }
+            Counters(const Counters& other) = delete;
+            Counters& operator=(const Counters& other) = delete;
+            ~Counters() {
+                for (const Event& event : events)
+                    if (event.fd >= 0)
+                        close(event.fd);
+            }
+
+            vector<string> names() const {
+                vector<string> result;
+                for (const Event& event : events)
+                    result.push_back(event.name);
+                return result;
+            }
+
+            bool anyAvailable() const {
+                for (const Event& event : events)
+                    if (event.fd >= 0)
+                        return true;
+                return false;
+            }
+
+            // One line per counter that can't be read, and why.
+            void describeUnavailable(ostream& output) const {
+                for (const Event& event : events)
+                    if (event.fd < 0)
+                        output << "counter " << event.name << " unavailable: " << event.error << endl;
+            }
+
+            void start() {
+                for (const Event& event : events) {
+                    if (event.fd >= 0) {
+                        ioctl(event.fd, PERF_EVENT_IOC_RESET, 0);
+                        ioctl(event.fd, PERF_EVENT_IOC_ENABLE, 0);
+                    }
+                }
+            }
+
+            // Counts since start(), in the order of names(); NaN where unavailable.
+            vector<double> stop() {
+                for (const Event& event : events)
+                    if (event.fd >= 0)
+                        ioctl(event.fd, PERF_EVENT_IOC_DISABLE, 0);
+                vector<double> counts;
+                for (const Event& event : events) {
+                    uint64_t values[3] = {};    // value, time enabled, time running
+                    if (event.fd < 0 || read(event.fd, values, sizeof(values)) != ssize_t(sizeof(values)) || values[2] == 0)
+                        counts.push_back(numeric_limits<double>::quiet_NaN());
+                    else
+                        counts.push_back(double(values[0]) * double(values[1]) / double(values[2]));
+                }
+                return counts;
+            }
+    };
+}
@@ -0,0 +1,165 @@
+/**
+ * Micro-benchmarks of every public Fraction operation. Run with `make bench`.
+ *
+ * Every benchmark runs on each workload picked with --workload (see
+ * BenchWorkloads.hpp), and is named after it: "fraction + fraction [farey]".
+ * Overflows, which near-overflow is made for, are caught and count as done;
+ * with --latency the tail is also broken down into calls that overflowed and
+ * those that didn't.
+ *
+ * Usage: ./bench_fraction [--filter TEXT] [--samples N] [--min-time MS] [--json PATH] [--csv PATH] [--counters all|LIST]
+ *                         [--latency CALLS] [--workload NAME|all]... [--seed N]
+ */
+
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "BenchHarness.hpp"
+#include "BenchWorkloads.hpp"
+#include "Fraction.hpp"
+
+using namespace ariel;
+using bench::do_not_optimize;
+
+static const size_t table_size = 1024;
+static const size_t mask = table_size - 1;
+
+// Runs every benchmark on one workload.
+static void run_workload(bench::Harness& harness, const bench::Workload& workload) {
+    const vector<Fraction>& lhs = workload.lhs;
+    const vector<Fraction>& rhs = workload.rhs;
+    const vector<float>& floats = workload.floats;
+    const vector<pair<int, int>>& pairs = workload.unreduced;
+    string suffix = string(" [") + bench::distribution_name(workload.distribution) + "]";
+    auto run = [&](const string& name, auto body) {
+        harness.run(name + suffix, [&](size_t index) {
+            try {
+                body(index);
+                harness.classify("no overflow");
+            }
+            catch (const overflow_error&) {
+                harness.classify("overflow");
+            }
+        });
+    };
+
+    // Constructors and assignment:
+    run("Fraction()", [&](size_t) { Fraction value; do_not_optimize(value); });
+    run("Fraction(int, int)", [&](size_t index) {
+        Fraction value(lhs[index & mask].getNumerator(), rhs[index & mask].getDenominator());
+        do_not_optimize(value);
+    });
+    run("Fraction(int, int) reduce", [&](size_t index) {
+        Fraction value(pairs[index & mask].first, pairs[index & mask].second);
+        do_not_optimize(value);
+    });
+    run("Fraction(float)", [&](size_t index) { Fraction value(floats[index & mask]); do_not_optimize(value); });
+    run("Fraction(const Fraction&)", [&](size_t index) { Fraction value(lhs[index & mask]); do_not_optimize(value); });
+    run("Fraction(Fraction&&)", [&](size_t index) {
+        Fraction source(lhs[index & mask]);
+        Fraction value(move(source));
+        do_not_optimize(value);
+    });
+    Fraction target;
+    run("operator=(const Fraction&)", [&](size_t index) { target = lhs[index & mask]; do_not_optimize(target); });
+    run("operator=(Fraction&&)", [&](size_t index) {
+        Fraction source(lhs[index & mask]);
+        target = move(source);
+        do_not_optimize(target);
+    });
+    run("setNumerator", [&](size_t index) { target.setNumerator(pairs[index & mask].first); do_not_optimize(target); });
+    run("setDenominator", [&](size_t index) { target.setDenominator(pairs[index & mask].second); do_not_optimize(target); });
+
+    // Arithmetic:
+    run("-fraction", [&](size_t index) { do_not_optimize(-lhs[index & mask]); });
+    run("fraction + fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] + rhs[index & mask]); });
+    run("fraction - fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] - rhs[index & mask]); });
+    run("fraction * fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] * rhs[index & mask]); });
+    run("fraction / fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] / rhs[index & mask]); });
+    run("fraction + float", [&](size_t index) { do_not_optimize(lhs[index & mask] + floats[index & mask]); });
+    run("fraction - float", [&](size_t index) { do_not_optimize(lhs[index & mask] - floats[index & mask]); });
+    run("fraction * float", [&](size_t index) { do_not_optimize(lhs[index & mask] * floats[index & mask]); });
+    run("fraction / float", [&](size_t index) { do_not_optimize(lhs[index & mask] / floats[index & mask]); });
+    run("float + fraction", [&](size_t index) { do_not_optimize(floats[index & mask] + lhs[index & mask]); });
+    run("float - fraction", [&](size_t index) { do_not_optimize(floats[index & mask] - lhs[index & mask]); });
+    run("float * fraction", [&](size_t index) { do_not_optimize(floats[index & mask] * lhs[index & mask]); });
+    run("float / fraction", [&](size_t index) { do_not_optimize(floats[index & mask] / lhs[index & mask]); });
+
+    // Comparisons:
+    run("fraction == fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] == rhs[index & mask]); });
+    run("fraction != fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] != rhs[index & mask]); });
+    run("fraction < fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] < rhs[index & mask]); });
+    run("fraction > fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] > rhs[index & mask]); });
+    run("fraction <= fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] <= rhs[index & mask]); });
+    run("fraction >= fraction", [&](size_t index) { do_not_optimize(lhs[index & mask] >= rhs[index & mask]); });
+    run("fraction == float", [&](size_t index) { do_not_optimize(lhs[index & mask] == floats[index & mask]); });
+    run("fraction != float", [&](size_t index) { do_not_optimize(lhs[index & mask] != floats[index & mask]); });
+    run("fraction < float", [&](size_t index) { do_not_optimize(lhs[index & mask] < floats[index & mask]); });
+    run("fraction > float", [&](size_t index) { do_not_optimize(lhs[index & mask] > floats[index & mask]); });
+    run("fraction <= float", [&](size_t index) { do_not_optimize(lhs[index & mask] <= floats[index & mask]); });
+    run("fraction >= float", [&](size_t index) { do_not_optimize(lhs[index & mask] >= floats[index & mask]); });
+    run("float == fraction", [&](size_t index) { do_not_optimize(floats[index & mask] == lhs[index & mask]); });
+    run("float != fraction", [&](size_t index) { do_not_optimize(floats[index & mask] != lhs[index & mask]); });
+    run("float < fraction", [&](size_t index) { do_not_optimize(floats[index & mask] < lhs[index & mask]); });
+    run("float > fraction", [&](size_t index) { do_not_optimize(floats[index & mask] > lhs[index & mask]); });
+    run("float <= fraction", [&](size_t index) { do_not_optimize(floats[index & mask] <= lhs[index & mask]); });
+    run("float >= fraction", [&](size_t index) { do_not_optimize(floats[index & mask] >= lhs[index & mask]); });
+
+    // Increment and decrement, restarting every table_size steps so the value stays small:
+    Fraction counter;
+    run("++fraction", [&](size_t index) {
+        if ((index & mask) == 0)
+            counter = lhs[index & mask];
+        do_not_optimize(++counter);
+    });
+    run("--fraction", [&](size_t index) {
+        if ((index & mask) == 0)
+            counter = lhs[index & mask];
+        do_not_optimize(--counter);
+    });
+    run("fraction++", [&](size_t index) {
+        if ((index & mask) == 0)
+            counter = lhs[index & mask];
+        do_not_optimize(counter++);
+    });
+    run("fraction--", [&](size_t index) {
+        if ((index & mask) == 0)
+            counter = lhs[index & mask];
+        do_not_optimize(counter--);
+    });
+
+    // Stream I/O:
+    ostringstream output;
+    run("operator<<", [&](size_t index) {
+        if ((index & mask) == 0)
+            output.str(string());
+        output << lhs[index & mask];
+    });
+    string text;
+    for (const Fraction& value : lhs)
+        text += to_string(value.getNumerator()) + " " + to_string(value.getDenominator()) + " ";
+    istringstream input(text);
+    Fraction parsed;
+    run("operator>>", [&](size_t index) {
+        if ((index & mask) == 0) {
+            input.clear();
+            input.seekg(0);
+        }
+        input >> parsed;
+        do_not_optimize(parsed);
+    });
+
+}
+
+int main(int argc, char** argv) {
+    bench::Harness harness(argc, argv);
+    uint64_t seed = bench::seed_from_args(argc, argv);
+    for (bench::Distribution distribution : bench::distributions_from_args(argc, argv))
+        run_workload(harness, bench::make_workload(distribution, table_size, seed));
+
+    harness.report(cout);
+    harness.save();
+}
@@ -0,0 +1,445 @@
+#pragma once
+
+/**
+ * A small self-contained micro-benchmark harness.
+ *
+ * Each benchmark is a callable taking the iteration index. The harness first
+ * finds an iteration count that runs for at least the minimum sample time,
+ * then takes that many iterations per sample, several samples in a row, and
+ * reports the mean time per operation, operations per second and the spread
+ * between samples.
+ *
+ *     Harness harness(argc, argv);
+ *     harness.run("add", [&](size_t index) { do_not_optimize(a[index & mask] + b[index & mask]); });
+ *     harness.report(cout);
+ *     harness.save();
+ *
+ * Command line: --filter TEXT (only benchmarks whose name contains TEXT),
+ * --samples N (default 10), --min-time MS (per sample, default 20),
+ * --json PATH and --csv PATH (where save() writes the results, together
+ * with the CPU and compiler they were measured with, for bench_compare),
+ * --counters all|LIST (hardware counters per operation, see BenchCounters.hpp;
+ * LIST is comma separated, e.g. cycles,instructions),
+ * --latency CALLS (time CALLS single calls and report p50, p99, p99.9 and max,
+ * see BenchHistogram.hpp).
+ *
+ * In --latency mode a body may call classify("label") to put the current
+ * call into an input class, e.g. the calls that threw; the tail is then
+ * also reported for each class.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchCounters.hpp"
+#include "BenchHistogram.hpp"
+
+namespace bench
+{
+    using namespace std;
+
+    // Keeps the compiler from dropping a computation whose result is unused.
+    template <typename T>
+    inline void do_not_optimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // Where the numbers were measured.
+    struct Context {
+        string cpu;
+        unsigned threads;
+        string compiler;
+        bool optimized;
+        string date;
+
+        static Context current() {
+            Context context{"unknown", thread::hardware_concurrency(), "unknown", false, ""};
+            ifstream cpuinfo("/proc/cpuinfo");
+            for (string line; getline(cpuinfo, line);) {
+                if (line.compare(0, 10, "model name") == 0 && line.find(':') != string::npos) {
+                    context.cpu = line.substr(line.find(':') + 2);
+                    break;
+                }
+            }
+#if defined(__clang__)
+            context.compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+            context.compiler = "g++ " __VERSION__;
+#endif
+#if defined(__OPTIMIZE__)
+            context.optimized = true;
+#endif
+            time_t now = time(nullptr);
+            char date[32] = {};
+            strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+            context.date = date;
+            return context;
+        }
+    };
+
+    inline string json_string(const string& text) {
+        string quoted = "\"";
+        for (char character : text) {
+            if (character == '"' || character == '\\')
+                quoted += '\\';
+            if (static_cast<unsigned char>(character) >= 0x20)
+                quoted += character;
+        }
+        return quoted + "\"";
+    }
+
+    // CSV fields are quoted when they hold a comma or a quote.
+    inline string csv_field(const string& text) {
+        if (text.find_first_of(",\"") == string::npos)
+            return text;
+        string quoted = "\"";
+        for (char character : text)
+            quoted += character == '"' ? string("\"\"") : string(1, character);
+        return quoted + "\"";
+    }
+
+    // Puts a stream's flags and precision back when it goes out of scope,
+    // so that a report leaves the caller's formatting as it found it.
+    class StreamStateGuard {
+        private:
+            ostream& stream;
+            ios_base::fmtflags flags;
+            streamsize precision;
+
+        public:
+            explicit StreamStateGuard(ostream& stream_in):
+                stream(stream_in), flags(stream_in.flags()), precision(stream_in.precision()) {}
+            StreamStateGuard(const StreamStateGuard& other) = delete;
+            StreamStateGuard& operator=(const StreamStateGuard& other) = delete;
+            ~StreamStateGuard() {
+                stream.flags(flags);
+                stream.precision(precision);
+            }
+    };
+
+    // Per-call latency of one input class, in ns.
+    struct Latency {
+        string input_class;
+        uint64_t calls;
+        double p50;
+        double p99;
+        double p999;
+        double max;
+    };
+
+    struct Result {
+        string name;
+        size_t iterations;          // per sample
+        vector<double> samples;     // ns per operation, one per sample
+        vector<double> counters;    // per operation, as Harness::counterNames(); NaN if unavailable
+        vector<Latency> latency;    // all calls first, then each input class
+
+        double mean() const {
+            return accumulate(samples.begin(), samples.end(), 0.0) / double(samples.size());
+        }
+        // Sample variance of the ns per operation.
+        double variance() const {
+            if (samples.size() < 2)
+                return 0;
+            double average = mean();
+            double sum = 0;
+            for (double sample : samples)
+                sum += (sample - average) * (sample - average);
+            return sum / double(samples.size() - 1);
+        }
+        double stddev() const {
+            return sqrt(variance());
+        }
+        double opsPerSecond() const {
+            return 1e9 / mean();
+        }
+    };
+
+    class Harness {
+        private:
+            string filter;
+            string json_path;
+            string csv_path;
+            size_t sample_count = 10;
+            double min_sample_ns = 20e6;
+            vector<Result> results;
+            unique_ptr<Counters> counters;
+            size_t latency_calls = 0;
+            CallClock clock;
+            const char* input_class = nullptr;
+
+            template <typename Body>
+            static double time_iterations(Body& body, size_t iterations) {
+                auto start = chrono::steady_clock::now();
+                for (size_t index = 0; index < iterations; index++)
+                    body(index);
+                chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+                return elapsed.count();
+            }
+
+        public:
+            Harness(int argc, char** argv) {
+                for (int arg = 1; arg + 1 < argc; arg += 2) {
+                    if (strcmp(argv[arg], "--filter") == 0)
+                        filter = argv[arg + 1];
+                    else if (strcmp(argv[arg], "--samples") == 0)
+                        sample_count = size_t(max(1, atoi(argv[arg + 1])));
+                    else if (strcmp(argv[arg], "--min-time") == 0)
+                        min_sample_ns = atof(argv[arg + 1]) * 1e6;
+                    else if (strcmp(argv[arg], "--json") == 0)
+                        json_path = argv[arg + 1];
+                    else if (strcmp(argv[arg], "--csv") == 0)
+                        csv_path = argv[arg + 1];
+                    else if (strcmp(argv[arg], "--counters") == 0)
+                        counters = make_unique<Counters>(argv[arg + 1]);
+                    else if (strcmp(argv[arg], "--latency") == 0)
+                        latency_calls = size_t(max(0, atoi(argv[arg + 1])));
+                }
+                if (latency_calls > 0)
+                    clock.calibrate();
+                if (counters)
+                    counters->describeUnavailable(cerr);
+            }
+
+            template <typename Body>
+            void run(const string& name, Body body) {
+                if (!filter.empty() && name.find(filter) == string::npos)
+                    return;
+
+                // Double the iterations until a sample is long enough to time.
+                size_t iterations = 1;
+                for (double elapsed = time_iterations(body, iterations); elapsed < min_sample_ns;) {
+                    double scale = elapsed > 0 ? min(16.0, 1.2 * min_sample_ns / elapsed) : 16.0;
+                    iterations = size_t(double(iterations) * max(2.0, scale));
+                    elapsed = time_iterations(body, iterations);
+                }
+
+                Result result{name, iterations, {}, {}, {}};
+                for (size_t sample = 0; sample < sample_count; sample++)
+                    result.samples.push_back(time_iterations(body, iterations) / double(iterations));
+
+                // One more sample, counted.
+                if (counters && counters->anyAvailable()) {
+                    counters->start();
+                    time_iterations(body, iterations);
+                    result.counters = counters->stop();
+                    for (double& count : result.counters)
+                        count /= double(iterations);
+                }
+
+                if (latency_calls > 0)
+                    result.latency = time_calls(body);
+                results.push_back(result);
+            }
+
+        private:
+            // Times latency_calls single calls; the first histogram takes all
+            // of them, the others the calls of each input class.
+            template <typename Body>
+            vector<Latency> time_calls(Body& body) {
+                vector<string> classes = {"all"};
+                vector<LatencyHistogram> histograms(1);
+                for (size_t index = 0; index < latency_calls; index++) {
+                    input_class = nullptr;
+                    uint64_t before = CallClock::now();
+                    body(index);
+                    uint64_t ticks = clock.elapsed(before, CallClock::now());
+                    histograms[0].record(ticks);
+                    if (input_class == nullptr)
+                        continue;
+                    size_t found = size_t(find(classes.begin(), classes.end(), input_class) - classes.begin());
+                    if (found == classes.size()) {
+                        classes.emplace_back(input_class);
+                        histograms.emplace_back();
+                    }
+                    histograms[found].record(ticks);
+                }
+                input_class = nullptr;
+
+                vector<Latency> latency;
+                for (size_t index = 0; index < classes.size(); index++) {
+                    const LatencyHistogram& histogram = histograms[index];
+                    latency.push_back({classes[index], histogram.count(),
+                                       clock.toNanoseconds(histogram.percentile(50)), clock.toNanoseconds(histogram.percentile(99)),
+                                       clock.toNanoseconds(histogram.percentile(99.9)), clock.toNanoseconds(histogram.maximum())});
+                }
+                return latency;
+            }
+
+        public:
+            // Puts the running call into an input class, in --latency mode.
+            void classify(const char* label) {
+                input_class = label;
+            }
+
+            const vector<Result>& getResults() const {
+                return results;
+            }
+
+            vector<string> counterNames() const {
+                return counters && counters->anyAvailable() ? counters->names() : vector<string>();
+            }
+
+            void report(ostream& output) const {
+                StreamStateGuard guard(output);
+                output << left << setw(44) << "benchmark" << right << setw(12) << "ns/op" << setw(16) << "ops/s"
+                       << setw(14) << "variance" << setw(9) << "cv" << endl;
+                for (const Result& result : results) {
+                    output << left << setw(44) << result.name << right << fixed
+                           << setw(12) << setprecision(2) << result.mean()
+                           << setw(16) << setprecision(0) << result.opsPerSecond()
+                           << setw(14) << setprecision(4) << result.variance()
+                           << setw(8) << setprecision(1) << 100 * result.stddev() / result.mean() << "%" << endl;
+                }
+                reportCounters(output);
+                reportLatency(output);
+            }
+
+            void reportCounters(ostream& output) const {
+                vector<string> names = counterNames();
+                if (names.empty())
+                    return;
+                StreamStateGuard guard(output);
+                output << endl << left << setw(44) << "per operation" << right;
+                for (const string& counter : names)
+                    output << setw(16) << counter;
+                output << endl;
+                for (const Result& result : results) {
+                    output << left << setw(44) << result.name << right << fixed << setprecision(2);
+                    for (double count : result.counters) {
+                        if (isnan(count))
+                            output << setw(16) << "-";
+                        else
+                            output << setw(16) << count;
+                    }
+                    output << endl;
+                }
+            }
+
+            // The classes are listed under a benchmark when there are two or more.
+            void reportLatency(ostream& output) const {
+                if (latency_calls == 0)
+                    return;
+                StreamStateGuard guard(output);
+                output << endl << left << setw(44) << "latency (ns)" << right << setw(10) << "calls" << setw(12) << "p50"
+                       << setw(12) << "p99" << setw(12) << "p99.9" << setw(12) << "max" << endl;
+                for (const Result& result : results) {
+                    for (const Latency& latency : result.latency) {
+                        if (latency.input_class != "all" && result.latency.size() < 3)
+                            break;
+                        string label = latency.input_class == "all" ? result.name : "  " + latency.input_class;
+                        output << left << setw(44) << label << right << fixed << setprecision(1) << setw(10) << latency.calls
+                               << setw(12) << latency.p50 << setw(12) << latency.p99 << setw(12) << latency.p999
+                               << setw(12) << latency.max << endl;
+                    }
+                }
+            }
+
+            void writeJson(ostream& output, const Context& context) const {
+                StreamStateGuard guard(output);
+                output << setprecision(17) << "{\n  \"context\": {"
+                       << "\"cpu\": " << json_string(context.cpu) << ", \"threads\": " << context.threads
+                       << ", \"compiler\": " << json_string(context.compiler)
+                       << ", \"optimized\": " << (context.optimized ? "true" : "false")
+                       << ", \"date\": " << json_string(context.date) << "},\n  \"benchmarks\": [";
+                for (size_t index = 0; index < results.size(); index++) {
+                    const Result& result = results[index];
+                    output << (index == 0 ? "\n" : ",\n") << "    {\"name\": " << json_string(result.name)
+                           << ", \"iterations\": " << result.iterations << ", \"mean_ns\": " << result.mean()
+                           << ", \"variance\": " << result.variance() << ", \"ops_per_second\": " << result.opsPerSecond()
+                           << ", \"samples_ns\": [";
+                    for (size_t sample = 0; sample < result.samples.size(); sample++)
+                        output << (sample == 0 ? "" : ", ") << result.samples[sample];
+                    output << "]";
+                    vector<string> names = counterNames();
+                    if (!names.empty()) {
+                        output << ", \"counters\": {";
+                        for (size_t counter = 0; counter < names.size(); counter++) {
+                            output << (counter == 0 ? "" : ", ") << json_string(names[counter]) << ": ";
+                            if (isnan(result.counters[counter]))
+                                output << "null";
+                            else
+                                output << result.counters[counter];
+                        }
+                        output << "}";
+                    }
+                    if (!result.latency.empty()) {
+                        output << ", \"latency\": [";
+                        for (size_t index = 0; index < result.latency.size(); index++) {
+                            const Latency& latency = result.latency[index];
+                            output << (index == 0 ? "" : ", ") << "{\"class\": " << json_string(latency.input_class)
+                                   << ", \"calls\": " << latency.calls << ", \"p50_ns\": " << latency.p50
+                                   << ", \"p99_ns\": " << latency.p99 << ", \"p999_ns\": " << latency.p999
+                                   << ", \"max_ns\": " << latency.max << "}";
+                        }
+                        output << "]";
+                    }
+                    output << "}";
+                }
+                output << "\n  ]\n}\n";
+            }
+
+            // One row per benchmark; the samples are separated by ';'. The
+            // context comes first, as '#' comment lines.
+            void writeCsv(ostream& output, const Context& context) const {
+                StreamStateGuard guard(output);
+                output << setprecision(17) << "# cpu: " << context.cpu << "\n# threads: " << context.threads
+                       << "\n# compiler: " << context.compiler << "\n# optimized: " << (context.optimized ? "true" : "false")
+                       << "\n# date: " << context.date << "\n";
+                vector<string> names = counterNames();
+                output << "name,iterations,mean_ns,variance,ops_per_second,samples_ns";
+                for (const string& counter : names)
+                    output << "," << counter;
+                if (latency_calls > 0)
+                    output << ",p50_ns,p99_ns,p999_ns,max_ns";
+                output << "\n";
+                for (const Result& result : results) {
+                    output << csv_field(result.name) << "," << result.iterations << "," << result.mean() << ","
+                           << result.variance() << "," << result.opsPerSecond() << ",";
+                    for (size_t sample = 0; sample < result.samples.size(); sample++)
+                        output << (sample == 0 ? "" : ";") << result.samples[sample];
+                    for (double count : result.counters) {
+                        output << ",";
+                        if (!isnan(count))
+                            output << count;
+                    }
+                    // All calls; the classes are only in the JSON.
+                    if (!result.latency.empty())
+                        output << "," << result.latency[0].p50 << "," << result.latency[0].p99 << ","
+                               << result.latency[0].p999 << "," << result.latency[0].max;
+                    output << "\n";
+                }
+            }
+
+            // Writes the files asked for with --json and --csv. Throws
+            // runtime_error if one can't be written.
+            void save() const {
+                Context context = Context::current();
+                if (!json_path.empty()) {
+                    ofstream output(json_path);
+                    writeJson(output, context);
+                    if (!output)
+                        throw runtime_error("Can't write " + json_path);
+                }
+                if (!csv_path.empty()) {
+                    ofstream output(csv_path);
+                    writeCsv(output, context);
+                    if (!output)
+                        throw runtime_error("Can't write " + csv_path);
+                }
+            }
+    };
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+/**
+ * Per-call latencies for the harness's --latency mode: a cheap clock and an
+ * HDR-style histogram.
+ *
+ * The histogram is log-linear: exact below 128, and above that 64 buckets
+ * per power of two, so any recorded value is known to within 1/64 (1.6%)
+ * with a fixed few thousand counters, and recording is a shift and an add.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace bench
+{
+    using namespace std;
+
+    class LatencyHistogram {
+        private:
+            static constexpr size_t exact = 128;
+            static constexpr size_t per_octave = 64;
+
+            vector<uint64_t> counts;
+            uint64_t total = 0;
+            uint64_t largest = 0;
+
+            static size_t index_of(uint64_t value) {
+                if (value < exact)
+                    return size_t(value);
+                // Shift so that value >> shift is in [64, 128).
+                size_t shift = size_t(63 - __builtin_clzll(value)) - 6;
+                return exact + (shift - 1) * per_octave + size_t(value >> shift) - per_octave;
+            }
+
+            // The largest value that falls into bucket index.
+            static uint64_t highest_of(size_t index) {
+                if (index < exact)
+                    return index;
+                size_t shift = (index - exact) / per_octave + 1;
+                uint64_t leading = (index - exact) % per_octave + per_octave;
+                return ((leading + 1) << shift) - 1;
+            }
+
+        public:
+            void record(uint64_t value) {
+                size_t index = index_of(value);
+                if (index >= counts.size())
+                    counts.resize(index + 1);
+                counts[index]++;
+                total++;
+                largest = max(largest, value);
+            }
+
+            uint64_t count() const {
+                return total;
+            }
+            uint64_t maximum() const {
+                return largest;
+            }
+
+            // The smallest value that percent of the recorded values don't
+            // exceed, up to the bucket width.
+            uint64_t percentile(double percent) const {
+                uint64_t rank = uint64_t(percent / 100 * double(total) + 0.5);
+                uint64_t seen = 0;
+                for (size_t index = 0; index < counts.size(); index++) {
+                    seen += counts[index];
+                    if (seen >= max(rank, uint64_t(1)))
+                        return min(highest_of(index), largest);
+                }
+                return largest;
+            }
+    };
+
+    // Timestamps for timing single calls. On x86 the fenced TSC, which costs
+    // a few ns; elsewhere steady_clock. calibrate() measures the ns per tick
+    // and the cost of taking two timestamps, which elapsed() subtracts.
+    class CallClock {
+        private:
+            double ns_per_tick = 1;
+            uint64_t overhead = 0;
+
+        public:
+            static uint64_t now() {
+#if defined(__x86_64__)
+                _mm_lfence();
+                uint64_t ticks = __rdtsc();
+                _mm_lfence();
+                return ticks;
+#else
+                return uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+            }
+
+            void calibrate() {
+                auto start_time = chrono::steady_clock::now();
+                uint64_t start = now();
+                while (chrono::steady_clock::now() - start_time < chrono::milliseconds(20)) {
+                }
+                chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start_time;
+                ns_per_tick = elapsed.count() / double(now() - start);
+
+                overhead = UINT64_MAX;
+                for (int round = 0; round < 10000; round++) {
+                    uint64_t before = now();
+                    overhead = min(overhead, now() - before);
+                }
+            }
+
+            // Ticks between two timestamps, less the cost of taking them.
+            uint64_t elapsed(uint64_t before, uint64_t after) const {
+                return after - before > overhead ? after - before - overhead : 0;
+            }
+
+            double toNanoseconds(uint64_t ticks) const {
+                return double(ticks) * ns_per_tick;
+            }
+    };
+}
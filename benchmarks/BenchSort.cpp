@@ -0,0 +1,92 @@
+/**
+ * radix_sort and parallel_sort against std::sort with Fraction::operator<,
+ * on the values of each workload picked with --workload (see
+ * BenchWorkloads.hpp).
+ *
+ * The Fraction128 columns std::sort random 62 bit fractions, with
+ * operator< (exact 128 bit cross products) and with filteredLess, which
+ * compares in double first. The workloads only make int fractions, so
+ * these are drawn separately, from --seed.
+ *
+ * Usage: ./bench_sort [sizes...] [--workload NAME|all]... [--seed N]
+ *        (default sizes 1000000 10000000; 10^9 needs about 40 GB)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "BenchWorkloads.hpp"
+#include "FractionSort.hpp"
+#include "PackedFraction.hpp"
+
+using namespace ariel;
+
+// Times body() on a fresh copy of values; returns ns per element.
+template <typename Container, typename Body>
+double time_sort(const Container& values, size_t count, Body body) {
+    Container copy = values;
+    auto start = chrono::steady_clock::now();
+    body(copy);
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / double(count);
+}
+
+int main(int argc, char** argv) {
+    vector<size_t> sizes;
+    for (const string& arg : bench::positional_args(argc, argv))
+        sizes.push_back(size_t(atoll(arg.c_str())));
+    if (sizes.empty())
+        sizes = {1000000, 10000000};
+    uint64_t seed = bench::seed_from_args(argc, argv);
+
+    unsigned threads = max(1U, thread::hardware_concurrency());
+    cout << "threads: " << threads << endl;
+    cout << setw(20) << "workload" << setw(12) << "size" << setw(14) << "std::sort" << setw(14) << "radix"
+         << setw(14) << "parallel" << setw(14) << "radix column" << setw(10) << "speedup" << setw(14)
+         << "128 exact" << setw(14) << "128 filtered" << "   (ns per element)" << endl;
+
+    for (bench::Distribution distribution : bench::distributions_from_args(argc, argv)) {
+        mt19937_64 random(seed);
+        for (size_t size : sizes) {
+            vector<Fraction> values = bench::make_workload(distribution, size, seed).lhs;
+            FractionColumn column(values);
+            vector<Fraction128> wide_values;
+            wide_values.reserve(size);
+            for (size_t index = 0; index < size; index++)
+                wide_values.emplace_back(static_cast<int64_t>(random()) >> 2, (random() >> 2) | 1);
+
+            vector<Fraction> expected = values;
+            sort(expected.begin(), expected.end());
+            vector<Fraction> check = values;
+            parallel_sort(check);
+            if (check != expected) {
+                cerr << "parallel_sort and std::sort differ" << endl;
+                return 1;
+            }
+
+            double std_ns = time_sort(values, size, [](vector<Fraction>& data) { sort(data.begin(), data.end()); });
+            double radix_ns = time_sort(values, size, [](vector<Fraction>& data) { radix_sort(data); });
+            double parallel_ns = time_sort(values, size, [](vector<Fraction>& data) { parallel_sort(data); });
+            double column_ns = time_sort(column, size, [](FractionColumn& data) { radix_sort(data); });
+            double exact_ns = time_sort(wide_values, size, [](vector<Fraction128>& data) { sort(data.begin(), data.end()); });
+            double filtered_ns = time_sort(wide_values, size, [](vector<Fraction128>& data) {
+                sort(data.begin(), data.end(), [](const Fraction128& lhs, const Fraction128& rhs) {
+                    return Fraction128::filteredLess(lhs, rhs);
+                });
+            });
+
+            cout << setw(20) << bench::distribution_name(distribution) << setw(12) << size << fixed
+                 << setprecision(1) << setw(14) << std_ns << setw(14) << radix_ns << setw(14) << parallel_ns
+                 << setw(14) << column_ns << setw(9) << setprecision(2) << std_ns / min(radix_ns, parallel_ns) << "x"
+                 << setprecision(1) << setw(14) << exact_ns << setw(14) << filtered_ns << endl;
+        }
+    }
+}
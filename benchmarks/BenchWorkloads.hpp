@@ -0,0 +1,207 @@
+#pragma once
+
+/**
+ * Seeded operand generators, so that every benchmark can run on data shaped
+ * like real inputs and like the worst ones, not only on small constants.
+ *
+ *     Workload workload = make_workload(Distribution::farey, 1024, seed);
+ *     harness.run("add", [&](size_t index) { do_not_optimize(workload.lhs[index & mask] + workload.rhs[index & mask]); });
+ *
+ * The same distribution, count and seed always give the same operands.
+ * Except for near_overflow, whose purpose is the overflow checks, sums,
+ * differences, products and quotients of lhs[i] and rhs[i] fit in an int;
+ * floats go through Fraction(float), whose denominator of 1000 can still
+ * overflow. rhs and floats are never zero, so they can be divisors.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Fraction.hpp"
+
+namespace bench
+{
+    using namespace std;
+
+    enum class Distribution {
+        uniform,                // numerators and denominators up to 1000
+        farey,                  // neighbours in a Farey sequence, as close as fractions with those denominators get
+        fibonacci,              // ratios of consecutive Fibonacci numbers, the longest gcd for their size
+        near_overflow,          // numerators and denominators within 1024 of numeric_limits<int>::max()
+        shared_denominator,     // amounts in cents: lhs up to 1000.00, rhs up to 100.00
+        float_derived           // Fraction(float) of random floats in [-32, 32]
+    };
+
+    constexpr Distribution all_distributions[] = {
+        Distribution::uniform, Distribution::farey, Distribution::fibonacci,
+        Distribution::near_overflow, Distribution::shared_denominator, Distribution::float_derived
+    };
+
+    inline const char* distribution_name(Distribution distribution) {
+        switch (distribution) {
+            case Distribution::uniform: return "uniform";
+            case Distribution::farey: return "farey";
+            case Distribution::fibonacci: return "fibonacci";
+            case Distribution::near_overflow: return "near-overflow";
+            case Distribution::shared_denominator: return "shared-denominator";
+            case Distribution::float_derived: return "float-derived";
+        }
+        return "unknown";
+    }
+
+    // The distributions named by --workload NAME (repeatable, or "all");
+    // fallback if there is none. Unknown names are skipped.
+    inline vector<Distribution> distributions_from_args(int argc, char** argv,
+                                                        Distribution fallback = Distribution::uniform) {
+        vector<Distribution> distributions;
+        for (int arg = 1; arg + 1 < argc; arg++) {
+            if (strcmp(argv[arg], "--workload") != 0)
+                continue;
+            for (Distribution distribution : all_distributions)
+                if (strcmp(argv[arg + 1], "all") == 0 || strcmp(argv[arg + 1], distribution_name(distribution)) == 0)
+                    distributions.push_back(distribution);
+            arg++;
+        }
+        if (distributions.empty())
+            distributions.push_back(fallback);
+        return distributions;
+    }
+
+    // The seed given with --seed, or 2023.
+    inline uint64_t seed_from_args(int argc, char** argv) {
+        for (int arg = 1; arg + 1 < argc; arg++)
+            if (strcmp(argv[arg], "--seed") == 0)
+                return strtoull(argv[arg + 1], nullptr, 10);
+        return 2023;
+    }
+
+    // The arguments that aren't --workload or --seed or their values, for
+    // the benchmarks that also take plain arguments.
+    inline vector<string> positional_args(int argc, char** argv) {
+        vector<string> positional;
+        for (int arg = 1; arg < argc; arg++) {
+            if ((strcmp(argv[arg], "--workload") == 0 || strcmp(argv[arg], "--seed") == 0) && arg + 1 < argc)
+                arg++;
+            else
+                positional.push_back(argv[arg]);
+        }
+        return positional;
+    }
+
+    struct Workload {
+        Distribution distribution;
+        vector<ariel::Fraction> lhs;
+        vector<ariel::Fraction> rhs;
+        // Near rhs, clamped to the magnitudes Fraction(float) handles.
+        vector<float> floats;
+        // lhs unreduced, multiplied by a common factor where that fits.
+        vector<pair<int, int>> unreduced;
+    };
+
+    // Keeps |value| within [1/512, 2^21], where Fraction(float) neither
+    // truncates to zero nor overflows.
+    inline float clamp_float(double value) {
+        double magnitude = min(max(fabs(value), 1.0 / 512), double(1 << 21));
+        return float(value < 0 ? -magnitude : magnitude);
+    }
+
+    inline Workload make_workload(Distribution distribution, size_t count, uint64_t seed = 2023) {
+        using ariel::Fraction;
+        const int int_max = numeric_limits<int>::max();
+        mt19937_64 random(seed * 8 + uint64_t(distribution));
+        auto draw = [&](int low, int high) { return uniform_int_distribution<int>(low, high)(random); };
+        auto nonzero = [&](int bound) { return draw(1, bound) * (draw(0, 1) ? -1 : 1); };
+
+        Workload workload{distribution, {}, {}, {}, {}};
+        switch (distribution) {
+            case Distribution::uniform:
+                for (size_t index = 0; index < count; index++) {
+                    workload.lhs.emplace_back(nonzero(1000), draw(1, 1000));
+                    workload.rhs.emplace_back(nonzero(1000), draw(1, 1000));
+                }
+                break;
+
+            case Distribution::farey: {
+                // F_n without 0/1, from the next-term recurrence; it has
+                // about 0.3 n^2 terms. Pairs are consecutive terms, from a
+                // random start.
+                int order = 2;
+                while (0.3 * order * order < double(count + 2))
+                    order++;
+                vector<pair<int, int>> terms;
+                for (int a = 0, b = 1, c = 1, d = order; c <= order;) {
+                    int factor = (order + b) / d;
+                    int next_c = factor * c - a, next_d = factor * d - b;
+                    a = c, b = d, c = next_c, d = next_d;
+                    terms.emplace_back(a, b);
+                }
+                size_t pairs = terms.size() - 1;
+                size_t start = uniform_int_distribution<size_t>(0, pairs - 1)(random);
+                for (size_t index = 0; index < count; index++) {
+                    size_t term = (start + index) % pairs;
+                    workload.lhs.emplace_back(terms[term].first, terms[term].second);
+                    workload.rhs.emplace_back(terms[term + 1].first, terms[term + 1].second);
+                }
+                break;
+            }
+
+            case Distribution::fibonacci: {
+                // F(24) / F(23) is the largest ratio whose cross products
+                // with its neighbour still fit in an int.
+                vector<int> fibonacci = {0, 1};
+                while (fibonacci.size() < 25)
+                    fibonacci.push_back(fibonacci[fibonacci.size() - 1] + fibonacci[fibonacci.size() - 2]);
+                for (size_t index = 0; index < count; index++) {
+                    size_t term = size_t(draw(10, 23));
+                    int sign = draw(0, 1) ? -1 : 1;
+                    workload.lhs.emplace_back(sign * fibonacci[term + 1], fibonacci[term]);
+                    workload.rhs.emplace_back(sign * fibonacci[term], fibonacci[term - 1]);
+                }
+                break;
+            }
+
+            case Distribution::near_overflow:
+                // Half the denominators are small, so the values are huge too.
+                for (size_t index = 0; index < count; index++) {
+                    int sign = draw(0, 1) ? -1 : 1;
+                    workload.lhs.emplace_back(sign * (int_max - draw(0, 1023)), draw(0, 1) ? draw(1, 16) : int_max - draw(0, 1023));
+                    workload.rhs.emplace_back(int_max - draw(0, 1023), draw(0, 1) ? draw(1, 16) : int_max - draw(0, 1023));
+                }
+                break;
+
+            case Distribution::shared_denominator:
+                for (size_t index = 0; index < count; index++) {
+                    workload.lhs.emplace_back(nonzero(100000), 100);
+                    workload.rhs.emplace_back(nonzero(10000), 100);
+                }
+                break;
+
+            case Distribution::float_derived:
+                for (size_t index = 0; index < count; index++) {
+                    workload.lhs.emplace_back(clamp_float(uniform_real_distribution<double>(-32, 32)(random)));
+                    workload.rhs.emplace_back(clamp_float(uniform_real_distribution<double>(-32, 32)(random)));
+                }
+                break;
+        }
+
+        for (size_t index = 0; index < count; index++) {
+            const Fraction& value = workload.rhs[index];
+            workload.floats.push_back(clamp_float(double(value.getNumerator()) / value.getDenominator()));
+
+            int numerator = workload.lhs[index].getNumerator();
+            int denominator = workload.lhs[index].getDenominator();
+            int limit = int_max / max(abs(numerator), denominator);
+            int factor = limit >= 2 ? draw(2, min(limit, 98)) : 1;
+            workload.unreduced.emplace_back(numerator * factor, denominator * factor);
+        }
+        return workload;
+    }
+}
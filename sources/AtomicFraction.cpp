@@ -0,0 +1,91 @@
+#include "AtomicFraction.hpp"
+
+namespace ariel
+{
+    // Same failure ordering the std::atomic single-order overloads use.
+    static memory_order failure_order(memory_order order) {
+        if (order == memory_order_acq_rel)
+            return memory_order_acquire;
+        if (order == memory_order_release)
+            return memory_order_relaxed;
+        return order;
+    }
+
+    uint64_t AtomicFraction::pack(const Fraction& fraction) {
+        return (uint64_t(uint32_t(fraction.getNumerator())) << 32) | uint32_t(fraction.getDenominator());
+    }
+    Fraction AtomicFraction::unpack(uint64_t word) {
+        return Fraction(int(uint32_t(word >> 32)), int(uint32_t(word)));
+    }
+
+    // Constructors:
+
+    AtomicFraction::AtomicFraction(): bits(pack(Fraction())) {}
+    AtomicFraction::AtomicFraction(const Fraction& value): bits(pack(value)) {}
+
+    bool AtomicFraction::is_lock_free() const {
+        return bits.is_lock_free();
+    }
+
+    // Load, store and exchange:
+
+    Fraction AtomicFraction::load(memory_order order) const {
+        return unpack(bits.load(order));
+    }
+    void AtomicFraction::store(const Fraction& value, memory_order order) {
+        bits.store(pack(value), order);
+    }
+    Fraction AtomicFraction::exchange(const Fraction& value, memory_order order) {
+        return unpack(bits.exchange(pack(value), order));
+    }
+
+    bool AtomicFraction::compare_exchange_weak(Fraction& expected, const Fraction& desired, memory_order order) {
+        uint64_t current = pack(expected);
+        if (bits.compare_exchange_weak(current, pack(desired), order, failure_order(order)))
+            return true;
+
+        expected = unpack(current);
+        return false;
+    }
+    bool AtomicFraction::compare_exchange_strong(Fraction& expected, const Fraction& desired, memory_order order) {
+        uint64_t current = pack(expected);
+        if (bits.compare_exchange_strong(current, pack(desired), order, failure_order(order)))
+            return true;
+
+        expected = unpack(current);
+        return false;
+    }
+
+    // Read-modify-write operations:
+
+    Fraction AtomicFraction::fetch_add(const Fraction& operand, memory_order order) {
+        uint64_t current = bits.load(memory_order_relaxed);
+        while (!bits.compare_exchange_weak(current, pack(unpack(current) + operand), order, failure_order(order))) {}
+        return unpack(current);
+    }
+    Fraction AtomicFraction::fetch_sub(const Fraction& operand, memory_order order) {
+        uint64_t current = bits.load(memory_order_relaxed);
+        while (!bits.compare_exchange_weak(current, pack(unpack(current) - operand), order, failure_order(order))) {}
+        return unpack(current);
+    }
+    Fraction AtomicFraction::fetch_mul(const Fraction& operand, memory_order order) {
+        uint64_t current = bits.load(memory_order_relaxed);
+        while (!bits.compare_exchange_weak(current, pack(unpack(current) * operand), order, failure_order(order))) {}
+        return unpack(current);
+    }
+    Fraction AtomicFraction::fetch_div(const Fraction& operand, memory_order order) {
+        uint64_t current = bits.load(memory_order_relaxed);
+        while (!bits.compare_exchange_weak(current, pack(unpack(current) / operand), order, failure_order(order))) {}
+        return unpack(current);
+    }
+
+    // Conversion and assignment:
+
+    AtomicFraction::operator Fraction() const {
+        return load();
+    }
+    AtomicFraction& AtomicFraction::operator=(const Fraction& value) {
+        store(value);
+        return *this;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Fraction.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace ariel
+{
+    // A Fraction that can be shared between threads without a mutex.
+    // Numerator and denominator are packed into one 64 bit word, and since a
+    // Fraction is always reduced, equal values have equal words, so
+    // compare_exchange compares values.
+    //
+    // The read-modify-write operations are CAS loops that compute the new
+    // value with the Fraction operators (which reduce) before publishing it.
+    // If the arithmetic throws, the stored value is left unchanged.
+    class AtomicFraction {
+        private:
+            atomic<uint64_t> bits;
+
+            static uint64_t pack(const Fraction& fraction);
+            static Fraction unpack(uint64_t word);
+
+        public:
+            static constexpr bool is_always_lock_free = atomic<uint64_t>::is_always_lock_free;
+
+            // Constructors:
+            AtomicFraction();
+            AtomicFraction(const Fraction& value);
+            // Like atomic<T>, neither copyable nor movable:
+            AtomicFraction(const AtomicFraction& other) = delete;
+            AtomicFraction& operator=(const AtomicFraction& other) = delete;
+            AtomicFraction(AtomicFraction&& other) = delete;
+            AtomicFraction& operator=(AtomicFraction&& other) = delete;
+            ~AtomicFraction() = default;
+
+            bool is_lock_free() const;
+
+            Fraction load(memory_order order = memory_order_seq_cst) const;
+            void store(const Fraction& value, memory_order order = memory_order_seq_cst);
+            Fraction exchange(const Fraction& value, memory_order order = memory_order_seq_cst);
+
+            // On failure, expected is updated to the current value.
+            bool compare_exchange_weak(Fraction& expected, const Fraction& desired,
+                                       memory_order order = memory_order_seq_cst);
+            bool compare_exchange_strong(Fraction& expected, const Fraction& desired,
+                                         memory_order order = memory_order_seq_cst);
+
+            // Read-modify-write operations; return the previous value.
+            Fraction fetch_add(const Fraction& operand, memory_order order = memory_order_seq_cst);
+            Fraction fetch_sub(const Fraction& operand, memory_order order = memory_order_seq_cst);
+            Fraction fetch_mul(const Fraction& operand, memory_order order = memory_order_seq_cst);
+            Fraction fetch_div(const Fraction& operand, memory_order order = memory_order_seq_cst);
+
+            operator Fraction() const;
+            AtomicFraction& operator=(const Fraction& value);
+    };
+
+#if defined(__x86_64__)
+    static_assert(AtomicFraction::is_always_lock_free, "AtomicFraction must be lock-free on x86-64");
+#endif
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "Fraction.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace ariel
+{
+    // When a BasicFraction brings itself to lowest terms:
+    enum class Reduction {
+        // After every constructor, setter and operator, like Fraction does.
+        Always,
+        // Only strips shared powers of two along the way; a full gcd reduction
+        // happens when a result would not fit in an int, on output and on normalize().
+        Lazy,
+        // Only on normalize(). A result that does not fit in an int throws.
+        Explicit
+    };
+
+    // A fraction whose reduction policy is a template parameter.
+    // The denominator is always kept positive, but with Lazy and Explicit it is
+    // not necessarily coprime with the numerator, so the getters may return
+    // an unreduced pair. Operators compute in long long, so an unreduced
+    // intermediate never overflows before it had the chance to be reduced.
+    template <Reduction policy>
+    class BasicFraction {
+        private:
+            static constexpr int float_scale = 1000;
+
+            int numerator;
+            int denominator;
+
+            static bool fits(long long value) {
+                return value >= numeric_limits<int>::min() && value <= numeric_limits<int>::max();
+            }
+
+            static void full_reduce(long long& num, long long& den) {
+                long long gcd = std::gcd(num, den);
+                num /= gcd;
+                den /= gcd;
+            }
+
+            // Cheap partial reduction: removes the powers of two both share.
+            static void strip_twos(long long& num, long long& den) {
+                if (num == 0) {
+                    den = 1;
+                    return;
+                }
+                int shift = min(countr_zero(static_cast<unsigned long long>(num)),
+                                countr_zero(static_cast<unsigned long long>(den)));
+                num >>= shift;
+                den >>= shift;
+            }
+
+            // Stores a wide result according to the policy. den must not be zero.
+            void assign(long long num, long long den) {
+                if (den < 0) {
+                    num = -num;
+                    den = -den;
+                }
+
+                if constexpr (policy == Reduction::Always) {
+                    full_reduce(num, den);
+                }
+                else if constexpr (policy == Reduction::Lazy) {
+                    strip_twos(num, den);
+                    if (!fits(num) || !fits(den))
+                        full_reduce(num, den);
+                }
+
+                if (!fits(num) || !fits(den))
+                    throw overflow_error("Integer overflow! ");
+
+                numerator = static_cast<int>(num);
+                denominator = static_cast<int>(den);
+            }
+
+            static BasicFraction from_wide(long long num, long long den) {
+                BasicFraction result;
+                result.assign(num, den);
+                return result;
+            }
+
+        public:
+            // Constructors:
+            BasicFraction(): numerator(0), denominator(1) {}
+            BasicFraction(int numerator_in, int denominator_in): numerator(0), denominator(1) {
+                if (denominator_in == 0)
+                    throw invalid_argument("Denominator can't be zero!");
+
+                assign(numerator_in, denominator_in);
+            }
+            BasicFraction(float other): numerator(0), denominator(1) {
+                assign(static_cast<long long>(other * float_scale), float_scale);
+            }
+            BasicFraction(const Fraction& other): numerator(other.getNumerator()), denominator(other.getDenominator()) {}
+
+            // Conversion back to the always reduced Fraction:
+            explicit operator Fraction() const {
+                return Fraction(numerator, denominator);
+            }
+
+            // Get and Set functions:
+            int getNumerator() const {
+                return numerator;
+            }
+            int getDenominator() const {
+                return denominator;
+            }
+
+            void setNumerator(int numerator_in) {
+                assign(numerator_in, denominator);
+            }
+            void setDenominator(int denominator_in) {
+                if (denominator_in == 0)
+                    throw invalid_argument("Denominator can't be zero!");
+
+                assign(numerator, denominator_in);
+            }
+
+            // Brings the fraction to lowest terms, whatever the policy.
+            BasicFraction& normalize() {
+                long long num = numerator;
+                long long den = denominator;
+                full_reduce(num, den);
+                numerator = static_cast<int>(num);
+                denominator = static_cast<int>(den);
+                return *this;
+            }
+            BasicFraction normalized() const {
+                BasicFraction copy(*this);
+                return copy.normalize();
+            }
+
+            bool isNormalized() const {
+                return std::gcd(numerator, denominator) == 1;
+            }
+
+            // Arithmetic operators:
+            BasicFraction operator-() const {
+                return from_wide(-static_cast<long long>(numerator), denominator);
+            }
+
+            friend BasicFraction operator+(const BasicFraction& lhs, const BasicFraction& rhs) {
+                return from_wide(static_cast<long long>(lhs.numerator) * rhs.denominator +
+                                 static_cast<long long>(rhs.numerator) * lhs.denominator,
+                                 static_cast<long long>(lhs.denominator) * rhs.denominator);
+            }
+            friend BasicFraction operator-(const BasicFraction& lhs, const BasicFraction& rhs) {
+                return from_wide(static_cast<long long>(lhs.numerator) * rhs.denominator -
+                                 static_cast<long long>(rhs.numerator) * lhs.denominator,
+                                 static_cast<long long>(lhs.denominator) * rhs.denominator);
+            }
+            friend BasicFraction operator*(const BasicFraction& lhs, const BasicFraction& rhs) {
+                return from_wide(static_cast<long long>(lhs.numerator) * rhs.numerator,
+                                 static_cast<long long>(lhs.denominator) * rhs.denominator);
+            }
+            friend BasicFraction operator/(const BasicFraction& lhs, const BasicFraction& rhs) {
+                if (rhs.numerator == 0)
+                    throw runtime_error("Can't divide by zero!");
+
+                return from_wide(static_cast<long long>(lhs.numerator) * rhs.denominator,
+                                 static_cast<long long>(lhs.denominator) * rhs.numerator);
+            }
+
+            BasicFraction& operator+=(const BasicFraction& other) {
+                return *this = *this + other;
+            }
+            BasicFraction& operator-=(const BasicFraction& other) {
+                return *this = *this - other;
+            }
+            BasicFraction& operator*=(const BasicFraction& other) {
+                return *this = *this * other;
+            }
+            BasicFraction& operator/=(const BasicFraction& other) {
+                return *this = *this / other;
+            }
+
+            // Comparison operators:
+            // Exact cross multiplication in long long, so unreduced values compare
+            // correctly without being normalized first.
+            friend bool operator==(const BasicFraction& lhs, const BasicFraction& rhs) {
+                return static_cast<long long>(lhs.numerator) * rhs.denominator ==
+                       static_cast<long long>(rhs.numerator) * lhs.denominator;
+            }
+            friend bool operator!=(const BasicFraction& lhs, const BasicFraction& rhs) {
+                return !(lhs == rhs);
+            }
+            friend bool operator<(const BasicFraction& lhs, const BasicFraction& rhs) {
+                return static_cast<long long>(lhs.numerator) * rhs.denominator <
+                       static_cast<long long>(rhs.numerator) * lhs.denominator;
+            }
+            friend bool operator>(const BasicFraction& lhs, const BasicFraction& rhs) {
+                return rhs < lhs;
+            }
+            friend bool operator<=(const BasicFraction& lhs, const BasicFraction& rhs) {
+                return !(rhs < lhs);
+            }
+            friend bool operator>=(const BasicFraction& lhs, const BasicFraction& rhs) {
+                return !(lhs < rhs);
+            }
+
+            // Prefix increment and decrement operators:
+            BasicFraction& operator++() {
+                assign(static_cast<long long>(numerator) + denominator, denominator);
+                return *this;
+            }
+            BasicFraction& operator--() {
+                assign(static_cast<long long>(numerator) - denominator, denominator);
+                return *this;
+            }
+            // Postfix increment and decrement operators:
+            BasicFraction operator++(int) {
+                BasicFraction copy(*this);
+                ++(*this);
+                return copy;
+            }
+            BasicFraction operator--(int) {
+                BasicFraction copy(*this);
+                --(*this);
+                return copy;
+            }
+
+            // Output operator: always prints lowest terms.
+            friend ostream& operator<<(ostream& output, const BasicFraction& fraction) {
+                BasicFraction reduced = fraction.normalized();
+                output << reduced.numerator << "/" << reduced.denominator;
+                return output;
+            }
+    };
+
+    using EagerFraction = BasicFraction<Reduction::Always>;
+    using LazyFraction = BasicFraction<Reduction::Lazy>;
+    using ExplicitFraction = BasicFraction<Reduction::Explicit>;
+}
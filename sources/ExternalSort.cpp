@@ -0,0 +1,218 @@
+#include "ExternalSort.hpp"
+#include "FractionSort.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <stdexcept>
+
+namespace ariel
+{
+    // Removes the run files when the sort is done or fails.
+    struct RunFiles {
+        vector<string> paths;
+
+        RunFiles() = default;
+        RunFiles(const RunFiles& other) = delete;
+        RunFiles& operator=(const RunFiles& other) = delete;
+        ~RunFiles() {
+            for (const string& path : paths)
+                remove(path.c_str());
+        }
+    };
+
+    // A run being merged: the decoded current block and where we are in it.
+    struct RunCursor {
+        FractionFileReader reader;
+        vector<int> numerators;
+        vector<int> denominators;
+        size_t block;
+        size_t position;
+        size_t length;
+
+        explicit RunCursor(const string& path):
+            reader(path), numerators(reader.blockSize()), denominators(reader.blockSize()), block(0), position(0), length(0) {
+            load();
+        }
+
+        bool done() const {
+            return position == length;
+        }
+
+        // Decodes the current block and starts reading the next one.
+        void load() {
+            position = 0;
+            length = block < reader.blockCount() ? reader.decodeBlock(block, numerators.data(), denominators.data()) : 0;
+            reader.prefetchBlock(block + 1);
+        }
+
+        void advance() {
+            if (++position == length) {
+                block++;
+                load();
+            }
+        }
+    };
+
+    // A loser tree over the cursors: tree[0] holds the run with the smallest
+    // current value, every other node the run that lost the match played
+    // there. Replacing the winner's value replays only its path to the root.
+    class LoserTree {
+        private:
+            vector<RunCursor>& runs;
+            vector<size_t> tree;
+
+            // Exhausted runs lose to everything; ties go to the earlier run.
+            bool beats(size_t lhs, size_t rhs) const {
+                if (runs[lhs].done())
+                    return false;
+                if (runs[rhs].done())
+                    return true;
+                const RunCursor& left = runs[lhs];
+                const RunCursor& right = runs[rhs];
+                long long left_cross = static_cast<long long>(left.numerators[left.position]) * right.denominators[right.position];
+                long long right_cross = static_cast<long long>(right.numerators[right.position]) * left.denominators[left.position];
+                return left_cross < right_cross || (left_cross == right_cross && lhs < rhs);
+            }
+
+        public:
+            explicit LoserTree(vector<RunCursor>& runs_in): runs(runs_in), tree(runs_in.size()) {
+                // Leaves are nodes size .. 2 size - 1; winners of the matches below each node.
+                size_t size = runs.size();
+                vector<size_t> winners(2 * size);
+                for (size_t run = 0; run < size; run++)
+                    winners[size + run] = run;
+                for (size_t node = size - 1; node >= 1; node--) {
+                    size_t left = winners[2 * node];
+                    size_t right = winners[2 * node + 1];
+                    winners[node] = beats(left, right) ? left : right;
+                    tree[node] = beats(left, right) ? right : left;
+                }
+                tree[0] = winners[1];
+            }
+
+            size_t winner() const {
+                return tree[0];
+            }
+
+            // Call after the winner's cursor moved.
+            void replay() {
+                size_t winner = tree[0];
+                for (size_t node = (winner + runs.size()) / 2; node >= 1; node /= 2)
+                    if (beats(tree[node], winner))
+                        swap(tree[node], winner);
+                tree[0] = winner;
+            }
+    };
+
+    static string run_path(const string& output_path, const ExternalSortOptions& options, size_t run) {
+        string base = output_path;
+        if (!options.temp_directory.empty()) {
+            size_t slash = output_path.find_last_of('/');
+            base = options.temp_directory + "/" + (slash == string::npos ? output_path : output_path.substr(slash + 1));
+        }
+        return base + ".run" + to_string(run);
+    }
+
+    // Drops repeated values from a sorted column.
+    static void dedupe_sorted(FractionColumn& column) {
+        const vector<int>& numerators = column.getNumerators();
+        const vector<int>& denominators = column.getDenominators();
+        vector<int> unique_numerators;
+        vector<int> unique_denominators;
+        for (size_t index = 0; index < column.size(); index++) {
+            if (index > 0 && numerators[index] == numerators[index - 1] && denominators[index] == denominators[index - 1])
+                continue;
+            unique_numerators.push_back(numerators[index]);
+            unique_denominators.push_back(denominators[index]);
+        }
+        column.clear();
+        column.append_reduced(unique_numerators.data(), unique_denominators.data(), unique_numerators.size());
+    }
+
+    ExternalSortResult external_sort(const string& input_path, const string& output_path, const ExternalSortOptions& options) {
+        FractionFileReader input(input_path);
+        ExternalSortResult result{input.size(), 0, 0};
+        size_t capacity = max(input.blockSize(), options.memory_budget / external_sort_bytes_per_value);
+
+        // Everything fits: sort in memory, no runs.
+        if (input.size() <= capacity) {
+            FractionColumn column = input.read();
+            parallel_sort(column, options.threads);
+            if (options.dedupe)
+                dedupe_sorted(column);
+            write_fraction_file(output_path, column, options.block_size);
+            result.output_count = column.size();
+            result.runs = 1;
+            return result;
+        }
+
+        // Spill sorted runs.
+        RunFiles files;
+        FractionColumn run;
+        run.reserve(capacity + input.blockSize());
+        for (size_t block = 0; block < input.blockCount(); block++) {
+            input.prefetchBlock(block + 1);
+            input.decodeBlock(block, run);
+            if (run.size() >= capacity || block + 1 == input.blockCount()) {
+                parallel_sort(run, options.threads);
+                if (options.dedupe)
+                    dedupe_sorted(run);
+                files.paths.push_back(run_path(output_path, options, files.paths.size()));
+                write_fraction_file(files.paths.back(), run, options.block_size);
+                run.clear();
+            }
+        }
+        result.runs = files.paths.size();
+
+        // Merge them.
+        vector<RunCursor> runs;
+        runs.reserve(files.paths.size());
+        size_t total = 0;
+        size_t cursor_bytes = 0;
+        for (const string& path : files.paths) {
+            runs.emplace_back(path);
+            total += runs.back().reader.size();
+            cursor_bytes += 2 * sizeof(int) * runs.back().reader.blockSize();
+        }
+
+        // The output's dictionary is the union of the runs', and comes out of
+        // what the cursors leave of the budget; a union that may not fit,
+        // counting the copy it is built in, makes the output store its
+        // denominators raw instead.
+        size_t dictionary_budget = options.memory_budget - min(options.memory_budget, cursor_bytes);
+        vector<int> dictionary;
+        for (const RunCursor& run : runs) {
+            vector<int> denominators = run.reader.denominators();
+            if (2 * sizeof(int) * (dictionary.size() + denominators.size()) > dictionary_budget) {
+                dictionary = vector<int>();
+                break;
+            }
+            vector<int> merged;
+            merged.reserve(dictionary.size() + denominators.size());
+            set_union(dictionary.begin(), dictionary.end(), denominators.begin(), denominators.end(),
+                      back_inserter(merged));
+            dictionary.swap(merged);
+        }
+
+        FractionFileWriter output(output_path, move(dictionary), total, options.block_size);
+        LoserTree tree(runs);
+        int last_numerator = 0;
+        int last_denominator = 0;
+        while (!runs[tree.winner()].done()) {
+            RunCursor& next = runs[tree.winner()];
+            int numerator = next.numerators[next.position];
+            int denominator = next.denominators[next.position];
+            if (!options.dedupe || output.size() == 0 || numerator != last_numerator || denominator != last_denominator) {
+                output.push_back(numerator, denominator);
+                last_numerator = numerator;
+                last_denominator = denominator;
+            }
+            next.advance();
+            tree.replay();
+        }
+        output.finish();
+        result.output_count = output.size();
+        return result;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "FractionFile.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace ariel
+{
+    struct ExternalSortOptions {
+        // Memory for sorting. The input is cut into runs of about
+        // memory_budget / external_sort_bytes_per_value values each. The
+        // merge builds the output's dictionary within it as well, and stores
+        // the denominators raw if the dictionary wouldn't fit.
+        size_t memory_budget = size_t(256) << 20;
+        // Where the runs are spilled; empty means next to the output file.
+        string temp_directory;
+        // Keep only one of each group of equal values.
+        bool dedupe = false;
+        // Threads for sorting a run; 0 uses thread::hardware_concurrency().
+        unsigned threads = 0;
+        // Block size of the runs and of the output file.
+        size_t block_size = fraction_file_default_block_size;
+    };
+
+    // What a run costs in memory per value while it is being sorted.
+    constexpr size_t external_sort_bytes_per_value = 48;
+
+    struct ExternalSortResult {
+        size_t input_count;     // values read
+        size_t output_count;    // values written, fewer than read with dedupe
+        size_t runs;            // sorted runs spilled; 1 means no merge was needed
+    };
+
+    // Sorts a fraction file that may be larger than memory into another.
+    //
+    // The input is read a run at a time; each run is sorted with
+    // parallel_sort and spilled to a temporary fraction file. The runs are
+    // then merged in one pass through a loser tree, which finds the next
+    // value with one comparison per level, and the result is streamed out
+    // with FractionFileWriter. While a run's block is consumed, its next
+    // block is already being read from disk. Temporary files are removed,
+    // also when an exception is thrown; so is the partly written output.
+    //
+    // Throws runtime_error on I/O errors or a corrupt input.
+    ExternalSortResult external_sort(const string& input_path, const string& output_path,
+                                     const ExternalSortOptions& options = ExternalSortOptions());
+}
@@ -1,4 +1,9 @@
 #include "Fraction.hpp"
+#include "FractionStats.hpp"
+
+#if defined(FRACTION_VALIDATE)
+#include "FractionReference.hpp"
+#endif
 
 #include <algorithm>
 #include <limits>
@@ -6,72 +11,166 @@
 
 namespace ariel
 {
+#if defined(FRACTION_STATS)
+    // __gcd, counting the steps.
+    static unsigned int counted_gcd(unsigned int num1, unsigned int num2) {
+        size_t steps = 0;
+        while (num2 != 0) {
+            unsigned int remainder = num1 % num2;
+            num1 = num2;
+            num2 = remainder;
+            steps++;
+        }
+        fraction_stats_add(local_fraction_stats().gcd_iterations[min(steps, fraction_gcd_histogram_size - 1)]);
+        return num1;
+    }
+#endif
+
+#if defined(FRACTION_VALIDATE)
+    // Runs compute, checks its result or its overflow_error against the
+    // reference, and returns or rethrows it. Other exceptions pass through.
+    template <typename Compute>
+    static Fraction validated(char operation, const Fraction& lhs, const Fraction& rhs, Compute compute) {
+        ReferenceResult expected = reference_arithmetic(operation, lhs, rhs);
+        Fraction result;
+        try {
+            result = compute();
+        }
+        catch (const overflow_error&) {
+            if (!expected.overflow)
+                fraction_validation_failure(string(1, operation), lhs, rhs, describe_reference(expected), "overflow_error");
+            throw;
+        }
+        if (expected.overflow || result.getNumerator() != expected.numerator ||
+            result.getDenominator() != expected.denominator) {
+            string actual = to_string(result.getNumerator()) + "/" + to_string(result.getDenominator());
+            fraction_validation_failure(string(1, operation), lhs, rhs, describe_reference(expected), actual);
+        }
+        return result;
+    }
+
+    static void validate_comparison(const char* operation, const Fraction& lhs, const Fraction& rhs, bool result,
+                                    bool expected) {
+        if (result != expected)
+            fraction_validation_failure(operation, lhs, rhs, expected ? "true" : "false", result ? "true" : "false");
+    }
+#else
+    template <typename Compute>
+    static inline Fraction validated(char, const Fraction&, const Fraction&, Compute compute) {
+        return compute();
+    }
+#endif
+
     int Fraction::safe_addition(int num1, int num2) const{
+        if (num1 == 0 || num2 == 0)
+            FRACTION_STAT(fast_paths);
         if (num1 == 0)
             return num2;
         if (num2 == 0)
             return num1;
 
-        if ((num2 > 0 && num1 > numeric_limits<int>::max() - num2) ||
-            (num2 < 0 && num1 < numeric_limits<int>::min() - num2))
+        FRACTION_STAT(slow_paths);
+        int sum = 0;
+        if (__builtin_add_overflow(num1, num2, &sum)) {
+            FRACTION_STAT(overflow_errors);
             throw overflow_error("Integer overflow! ");
+        }
 
-        return num1 + num2;
+        return sum;
     }
     int Fraction::safe_subtract(int num1, int num2) const{
-        if (num1 == 0)
-            return -num2;
-        if (num2 == 0)
+        if (num2 == 0) {
+            FRACTION_STAT(fast_paths);
             return num1;
+        }
 
-        if ((num2 < 0 && num1 > numeric_limits<int>::max() + num2) ||
-            (num2 > 0 && num1 < numeric_limits<int>::min() + num2))
+        FRACTION_STAT(slow_paths);
+        int difference = 0;
+        if (__builtin_sub_overflow(num1, num2, &difference)) {
+            FRACTION_STAT(overflow_errors);
             throw overflow_error("Integer overflow! ");
+        }
 
-        return num1 - num2;
+        return difference;
     }
     int Fraction::safe_multiply(int num1, int num2) const {
         
-        if (num1 == 0 || num2 == 0)
+        if (num1 == 0 || num2 == 0) {
+            FRACTION_STAT(fast_paths);
             return 0;
+        }
 
-        if ((num2 > 0 && num1 > numeric_limits<int>::max() / num2) ||
-            (num2 < 0 && num1 < numeric_limits<int>::max() / num2))
+        FRACTION_STAT(slow_paths);
+        int product = 0;
+        if (__builtin_mul_overflow(num1, num2, &product)) {
+            FRACTION_STAT(overflow_errors);
             throw overflow_error("Integer overflow!");
-
-        return num1 * num2;
-    }
-
-    void Fraction::reduce() {
-        int gcd = __gcd(abs(numerator), abs(denominator));
-        numerator /= gcd;
-        denominator /= gcd;
-        
-        if (denominator < 0) {
-            // generally trying to keep the sign in the numerator
-            numerator = -numerator;
-            denominator = -denominator;
         }
+
+        return product;
+    }
+
+    // Out of line, so that reduce() stays small enough to be inlined into
+    // the copies and moves.
+    [[noreturn]] __attribute__((noinline, cold)) static void reduce_overflow() {
+        FRACTION_STAT(overflow_errors);
+        throw overflow_error("Integer overflow! ");
+    }
+
+    inline void Fraction::reduce() {
+        FRACTION_STAT(reductions);
+        // Reduced as magnitudes, which INT_MIN has too. The masks are all
+        // ones for negative values; the signs are random in real data, so
+        // this is kept free of branches on them.
+        unsigned int num_sign = unsigned(numerator >> 31);
+        unsigned int den_sign = unsigned(denominator >> 31);
+        unsigned int num_magnitude = (unsigned(numerator) ^ num_sign) - num_sign;
+        unsigned int den_magnitude = (unsigned(denominator) ^ den_sign) - den_sign;
+#if defined(FRACTION_STATS)
+        unsigned int gcd = counted_gcd(num_magnitude, den_magnitude);
+        if (gcd == 1)
+            FRACTION_STAT(already_reduced);
+#else
+        unsigned int gcd = __gcd(num_magnitude, den_magnitude);
+#endif
+        num_magnitude /= gcd;
+        den_magnitude /= gcd;
+
+        // generally trying to keep the sign in the numerator
+        unsigned int sign = num_sign ^ den_sign;
+        if (den_magnitude > unsigned(numeric_limits<int>::max()) ||
+            num_magnitude > unsigned(numeric_limits<int>::max()) - sign)
+            reduce_overflow();
+        numerator = int((num_magnitude ^ sign) - sign);
+        denominator = int(den_magnitude);
     }
 
     // Constructors:
 
     Fraction::Fraction() {
+        FRACTION_STAT(constructions);
         this->numerator = 0;
         this->denominator = 1;
     }
     Fraction::Fraction(int numerator_in, int denominator_in): numerator(numerator_in), denominator(denominator_in) {
-        if (denominator == 0)
+        FRACTION_STAT(constructions);
+        if (denominator == 0) {
+            FRACTION_STAT(invalid_arguments);
             throw invalid_argument("Denominator can't be zero!");
+        }
 
         reduce();
     }
     Fraction::Fraction(float other): numerator(int(other*1000)), denominator(1000) {
+        FRACTION_STAT(constructions);
         reduce();
     }
     Fraction::Fraction(const Fraction& other): numerator(other.getNumerator()), denominator(other.getDenominator()) {
-        if (denominator == 0)
+        FRACTION_STAT(constructions);
+        if (denominator == 0) {
+            FRACTION_STAT(runtime_errors);
             throw runtime_error("Denominator can't be zero!");
+        }
 
         reduce();
     }
@@ -89,6 +188,7 @@ namespace ariel
     // Move constructor and assignment operator:
 
     Fraction::Fraction(Fraction&& other) noexcept {
+        FRACTION_STAT(constructions);
         numerator = other.getNumerator();
         denominator = other.getDenominator();
         reduce();
@@ -129,35 +229,45 @@ namespace ariel
     // Arithmetic operators:
 
     Fraction Fraction::operator-() const {
-        return Fraction(-numerator, denominator);
+        return Fraction(safe_subtract(0, numerator), denominator);
     }
 
     Fraction Fraction::operator+(const Fraction& other) const {
-        int a = safe_multiply(numerator, other.getDenominator());
-        int b = safe_multiply(other.getNumerator(), denominator);
+        return validated('+', *this, other, [&] {
+            int a = safe_multiply(numerator, other.getDenominator());
+            int b = safe_multiply(other.getNumerator(), denominator);
 
-        return Fraction(safe_addition(a, b), safe_multiply(denominator, other.getDenominator()));
+            return Fraction(safe_addition(a, b), safe_multiply(denominator, other.getDenominator()));
+        });
     }
     Fraction Fraction::operator-(const Fraction& other) const {
-        int a = safe_multiply(numerator, other.getDenominator());
-        int b = safe_multiply(other.getNumerator(), denominator);
+        return validated('-', *this, other, [&] {
+            int a = safe_multiply(numerator, other.getDenominator());
+            int b = safe_multiply(other.getNumerator(), denominator);
 
-        return Fraction(safe_subtract(a, b), safe_multiply(denominator, other.getDenominator()));
+            return Fraction(safe_subtract(a, b), safe_multiply(denominator, other.getDenominator()));
+        });
     }
     Fraction Fraction::operator*(const Fraction& other) const {
-        int numerator = safe_multiply(this->numerator, other.getNumerator());
-        int denominator = safe_multiply(this->denominator, other.getDenominator());
+        return validated('*', *this, other, [&] {
+            int numerator = safe_multiply(this->numerator, other.getNumerator());
+            int denominator = safe_multiply(this->denominator, other.getDenominator());
 
-        return Fraction(numerator, denominator);
+            return Fraction(numerator, denominator);
+        });
     }
     Fraction Fraction::operator/(const Fraction& other) const {
-        if (other.getNumerator() == 0)
+        if (other.getNumerator() == 0) {
+            FRACTION_STAT(runtime_errors);
             throw runtime_error("Can't divide by zero!");
+        }
 
-        int numerator = safe_multiply(this->numerator, other.getDenominator());
-        int denominator = safe_multiply(this->denominator, other.getNumerator());
+        return validated('/', *this, other, [&] {
+            int numerator = safe_multiply(this->numerator, other.getDenominator());
+            int denominator = safe_multiply(this->denominator, other.getNumerator());
 
-        return Fraction(numerator, denominator);
+            return Fraction(numerator, denominator);
+        });
     }
 
     Fraction Fraction::operator+(const float& other) const {
@@ -200,17 +310,25 @@ namespace ariel
         Fraction this_reduced(*this);
         Fraction other_reduced(other);
 
-        return (this_reduced.getNumerator() == other_reduced.getNumerator() &&
-                this_reduced.getDenominator() == other_reduced.getDenominator());
+        bool result = (this_reduced.getNumerator() == other_reduced.getNumerator() &&
+                       this_reduced.getDenominator() == other_reduced.getDenominator());
+#if defined(FRACTION_VALIDATE)
+        validate_comparison("==", *this, other, result, reference_compare(*this, other) == 0);
+#endif
+        return result;
     }
     bool Fraction::operator!=(const Fraction& other) const {
         return !( (*this) == other );
     }
     bool Fraction::operator<(const Fraction& other) const {
-        int a = this->numerator * other.getDenominator();
-        int b = other.getNumerator() * this->denominator;
+        long long a = static_cast<long long>(this->numerator) * other.getDenominator();
+        long long b = static_cast<long long>(other.getNumerator()) * this->denominator;
 
-        return a < b;
+        bool result = a < b;
+#if defined(FRACTION_VALIDATE)
+        validate_comparison("<", *this, other, result, reference_compare(*this, other) < 0);
+#endif
+        return result;
     }
     bool Fraction::operator>(const Fraction& other) const {
         return other < (*this);
@@ -298,10 +416,14 @@ namespace ariel
         int numerator, denominator;
 
         input >> numerator >> denominator;
-        if (input.fail())
+        if (input.fail()) {
+            FRACTION_STAT(runtime_errors);
             throw runtime_error("Invalid input");
-        if (denominator == 0)
+        }
+        if (denominator == 0) {
+            FRACTION_STAT(runtime_errors);
             throw runtime_error("Denominator can't be zero!");
+        }
 
         fraction = Fraction(numerator, denominator);
         return input;
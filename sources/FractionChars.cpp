@@ -0,0 +1,327 @@
+#include "FractionChars.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ariel
+{
+    // Length of the run of decimal digits that starts at first.
+    static size_t digit_run(const char* first, const char* last) {
+        const char* cursor = first;
+#if defined(__SSE2__)
+        // 16 characters at a time: a byte is a digit if byte - '0' <= 9 unsigned.
+        const __m128i zero = _mm_set1_epi8('0');
+        const __m128i nine = _mm_set1_epi8(9);
+        while (last - cursor >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+            __m128i offset = _mm_sub_epi8(chunk, zero);
+            __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(offset, nine), offset);
+            unsigned mask = unsigned(_mm_movemask_epi8(is_digit));
+            if (mask != 0xFFFF)
+                return size_t(cursor - first) + size_t(countr_one(mask));
+            cursor += 16;
+        }
+#endif
+        while (cursor != last && unsigned(*cursor - '0') <= 9)
+            cursor++;
+        return size_t(cursor - first);
+    }
+
+    // Value of exactly eight digits, converted together (SWAR, little endian).
+    static uint64_t eight_digits(const char* digits) {
+        uint64_t chunk = 0;
+        memcpy(&chunk, digits, sizeof(chunk));
+        chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+        chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+        return ((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+    }
+
+    // Value of count digits; false if there are more than 19 significant ones.
+    static bool digits_value(const char* digits, size_t count, uint64_t& value) {
+        const size_t max_digits = 19; // 10^19 < 2^64
+        while (count > 0 && *digits == '0') {
+            digits++;
+            count--;
+        }
+        if (count > max_digits)
+            return false;
+
+        uint64_t result = 0;
+        if constexpr (endian::native == endian::little) {
+            for (; count >= 8; count -= 8, digits += 8)
+                result = result * 100000000 + eight_digits(digits);
+        }
+        for (; count > 0; count--, digits++)
+            result = result * 10 + uint64_t(*digits - '0');
+
+        value = result;
+        return true;
+    }
+
+    // An optional '-' and a run of digits. Returns first if there are no digits.
+    static const char* read_integer(const char* first, const char* last,
+                                    bool& negative, uint64_t& magnitude, bool& overflow) {
+        const char* cursor = first;
+        negative = cursor != last && *cursor == '-';
+        if (negative)
+            cursor++;
+
+        size_t count = digit_run(cursor, last);
+        if (count == 0)
+            return first;
+
+        if (!digits_value(cursor, count, magnitude))
+            overflow = true;
+        return cursor + count;
+    }
+
+    static from_chars_result finish(const char* end, bool negative, uint64_t numerator, uint64_t denominator,
+                                    bool overflow, Fraction& value) {
+        if (overflow)
+            return {end, errc::result_out_of_range};
+        if (denominator == 0)
+            return {end, errc::invalid_argument};
+
+        // The Fraction constructor reduces, so only reduce here when the
+        // unreduced pair would not fit in an int.
+        const uint64_t max_numerator = negative ? uint64_t(numeric_limits<int>::max()) + 1 : uint64_t(numeric_limits<int>::max());
+        const uint64_t max_denominator = uint64_t(numeric_limits<int>::max());
+        if (numerator > max_numerator || denominator > max_denominator) {
+            uint64_t divisor = gcd(numerator, denominator);
+            numerator /= divisor;
+            denominator /= divisor;
+            if (numerator > max_numerator || denominator > max_denominator)
+                return {end, errc::result_out_of_range};
+        }
+
+        long long signed_numerator = negative ? -(long long)(numerator) : (long long)(numerator);
+        value = Fraction(int(signed_numerator), int(denominator));
+        return {end, errc()};
+    }
+
+    from_chars_result from_chars(const char* first, const char* last, Fraction& value) {
+        bool negative = false;
+        bool overflow = false;
+        uint64_t numerator = 0;
+        const char* cursor = read_integer(first, last, negative, numerator, overflow);
+        if (cursor == first)
+            return {first, errc::invalid_argument};
+
+        if (cursor == last)
+            return finish(cursor, negative, numerator, 1, overflow, value);
+
+        // "a/b"
+        if (*cursor == '/') {
+            bool denominator_negative = false;
+            uint64_t denominator = 0;
+            const char* end = read_integer(cursor + 1, last, denominator_negative, denominator, overflow);
+            if (end != cursor + 1)
+                return finish(end, negative != denominator_negative, numerator, denominator, overflow, value);
+        }
+        // "a.bcd"
+        else if (*cursor == '.') {
+            const char* digits = cursor + 1;
+            size_t count = digit_run(digits, last);
+            if (count > 0) {
+                const char* end = digits + count;
+                // Trailing zeros don't change the value.
+                while (count > 0 && digits[count - 1] == '0')
+                    count--;
+
+                uint64_t fractional = 0;
+                uint64_t scale = 1;
+                const size_t max_scale_digits = 19;
+                if (count > max_scale_digits || !digits_value(digits, count, fractional))
+                    overflow = true;
+                for (size_t index = 0; index < count && !overflow; index++)
+                    scale *= 10;
+                if (__builtin_mul_overflow(numerator, scale, &numerator) ||
+                    __builtin_add_overflow(numerator, fractional, &numerator))
+                    overflow = true;
+
+                return finish(end, negative, numerator, scale, overflow, value);
+            }
+        }
+        // "a b"
+        else if (*cursor == ' ' || *cursor == '\t') {
+            const char* gap = cursor;
+            while (gap != last && (*gap == ' ' || *gap == '\t'))
+                gap++;
+
+            bool denominator_negative = false;
+            uint64_t denominator = 0;
+            const char* end = read_integer(gap, last, denominator_negative, denominator, overflow);
+            if (end != gap)
+                return finish(end, negative != denominator_negative, numerator, denominator, overflow, value);
+        }
+
+        return finish(cursor, negative, numerator, 1, overflow, value);
+    }
+
+    // Output:
+
+    static const char digit_pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    static size_t decimal_length(uint32_t value) {
+        size_t length = 1;
+        for (uint32_t bound = 10; length < 10 && value >= bound; bound *= 10)
+            length++;
+        return length;
+    }
+
+    // Writes the last count digits of value, two at a time from the right.
+    static void write_digits(char* first, size_t count, uint64_t value) {
+        char* cursor = first + count;
+        while (cursor - first >= 2) {
+            const char* pair = digit_pairs + 2 * (value % 100);
+            value /= 100;
+            cursor -= 2;
+            cursor[0] = pair[0];
+            cursor[1] = pair[1];
+        }
+        if (cursor != first)
+            first[0] = char('0' + value % 10);
+    }
+
+    // Writes value in decimal; nullptr if it doesn't fit.
+    static char* write_unsigned(char* first, char* last, uint32_t value) {
+        size_t length = decimal_length(value);
+        if (size_t(last - first) < length)
+            return nullptr;
+        write_digits(first, length, value);
+        return first + length;
+    }
+
+    static char* write_char(char* first, char* last, char character) {
+        if (first == last)
+            return nullptr;
+        *first = character;
+        return first + 1;
+    }
+
+    static char* write_ratio(char* first, char* last, bool negative, uint32_t numerator, uint32_t denominator) {
+        if (negative)
+            first = write_char(first, last, '-');
+        if (first != nullptr)
+            first = write_unsigned(first, last, numerator);
+        if (first != nullptr)
+            first = write_char(first, last, '/');
+        if (first != nullptr)
+            first = write_unsigned(first, last, denominator);
+        return first;
+    }
+
+    static char* write_mixed(char* first, char* last, bool negative, uint32_t numerator, uint32_t denominator) {
+        uint32_t whole = numerator / denominator;
+        uint32_t remainder = numerator % denominator;
+        if (whole == 0)
+            return remainder == 0 ? write_char(first, last, '0') : write_ratio(first, last, negative, remainder, denominator);
+
+        if (negative)
+            first = write_char(first, last, '-');
+        if (first != nullptr)
+            first = write_unsigned(first, last, whole);
+        if (first != nullptr && remainder != 0) {
+            first = write_char(first, last, ' ');
+            if (first != nullptr)
+                first = write_ratio(first, last, false, remainder, denominator);
+        }
+        return first;
+    }
+
+    static char* write_decimal(char* first, char* last, bool negative, uint32_t numerator, uint32_t denominator, int precision) {
+        if (negative)
+            first = write_char(first, last, '-');
+        char* whole_start = first;
+        if (first != nullptr)
+            first = write_unsigned(first, last, numerator / denominator);
+        if (first == nullptr || precision <= 0) {
+            // Round the whole part on its own.
+            if (first != nullptr && 2 * uint64_t(numerator % denominator) >= denominator)
+                first = write_unsigned(whole_start, last, numerator / denominator + 1);
+            return first;
+        }
+
+        first = write_char(first, last, '.');
+        if (first == nullptr || last - first < precision)
+            return nullptr;
+
+        // Up to nine digits per division: remainder * 10^9 < 2^31 * 10^9 < 2^64.
+        static const uint64_t powers_of_ten[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+        const int chunk_digits = 9;
+        uint64_t remainder = numerator % denominator;
+        for (int left = precision; left > 0;) {
+            int count = min(left, chunk_digits);
+            uint64_t scaled = remainder * powers_of_ten[count];
+            write_digits(first, size_t(count), scaled / denominator);
+            remainder = scaled % denominator;
+            first += count;
+            left -= count;
+        }
+
+        // Round half away from zero, carrying through the digits.
+        if (2 * remainder >= denominator) {
+            char* cursor = first;
+            while (cursor != whole_start) {
+                cursor--;
+                if (*cursor == '.')
+                    continue;
+                if (*cursor != '9') {
+                    (*cursor)++;
+                    return first;
+                }
+                *cursor = '0';
+            }
+            // All nines: the whole part gains a leading 1.
+            if (first == last)
+                return nullptr;
+            memmove(whole_start + 1, whole_start, size_t(first - whole_start));
+            *whole_start = '1';
+            first++;
+        }
+        return first;
+    }
+
+    to_chars_result to_chars(char* first, char* last, const Fraction& value, FractionFormat format, int precision) {
+        int numerator = value.getNumerator();
+        bool negative = numerator < 0;
+        // Magnitude without overflowing on INT_MIN
+        uint32_t magnitude = negative ? 0U - uint32_t(numerator) : uint32_t(numerator);
+        uint32_t denominator = uint32_t(value.getDenominator());
+
+        char* end = nullptr;
+        switch (format) {
+            case FractionFormat::Ratio:
+                end = write_ratio(first, last, negative, magnitude, denominator);
+                break;
+            case FractionFormat::Mixed:
+                end = write_mixed(first, last, negative, magnitude, denominator);
+                break;
+            case FractionFormat::Decimal:
+                end = write_decimal(first, last, negative, magnitude, denominator, precision);
+                break;
+        }
+
+        if (end == nullptr)
+            return {last, errc::value_too_large};
+        return {end, errc()};
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Fraction.hpp"
+
+#include <charconv>
+#include <cstddef>
+
+namespace ariel
+{
+    // Parses a Fraction from [first, last) without exceptions, locales or
+    // allocations, in the manner of std::from_chars. Accepted forms:
+    //     "3/4"     numerator '/' denominator
+    //     "3 4"     numerator, spaces or tabs, denominator (what operator>> reads)
+    //     "-7"      a plain integer
+    //     "12.963"  a decimal literal, converted exactly (12963/1000)
+    // Either integer may carry a leading '-'. Leading whitespace is not skipped.
+    //
+    // On success ec is errc() and ptr points past the parsed text. If no
+    // number starts at first, ec is errc::invalid_argument and ptr is first.
+    // A zero denominator gives errc::invalid_argument and a value that does
+    // not fit in a Fraction gives errc::result_out_of_range; in both cases ptr
+    // points past the text that was rejected. value is only written on success.
+    from_chars_result from_chars(const char* first, const char* last, Fraction& value);
+
+    // How to_chars writes a Fraction:
+    enum class FractionFormat {
+        // "-7/3", what operator<< writes
+        Ratio,
+        // "-2 1/3", "5", "1/3": whole part and proper remainder
+        Mixed,
+        // "-2.333": fixed point with the given number of digits, rounded half away from zero
+        Decimal
+    };
+
+    // A buffer of this many chars is always big enough for the Ratio and Mixed
+    // formats ("-2147483648/1" .. "-1073741823 1073741823/1073741824").
+    constexpr size_t fraction_chars_max = 33;
+    // Same for the Decimal format: sign, ten integer digits, '.' and the digits.
+    constexpr size_t fraction_chars_max_decimal(int precision) {
+        return precision > 0 ? 12 + size_t(precision) : 11;
+    }
+
+    // Writes value into [first, last) without allocating, in the manner of
+    // std::to_chars. On success ec is errc() and ptr points past the last char
+    // written; if the buffer is too small ec is errc::value_too_large and ptr
+    // is last. The output is not null terminated.
+    to_chars_result to_chars(char* first, char* last, const Fraction& value,
+                             FractionFormat format = FractionFormat::Ratio, int precision = 3);
+}
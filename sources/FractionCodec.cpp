@@ -0,0 +1,170 @@
+#include "FractionCodec.hpp"
+#include "Varint.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace ariel
+{
+    // Writes one value into out, which has room for max_encoded_fraction_size bytes.
+    static uint8_t* encode_value(uint8_t* out, bool delta, int& previous_numerator, int& previous_denominator,
+                                 int numerator, int denominator) {
+        if (delta) {
+            bool same = denominator == previous_denominator;
+            int64_t step = int64_t(numerator) - previous_numerator;
+            out = write_varint(out, (zigzag_encode(step) << 1) | (same ? 1 : 0));
+            if (!same)
+                out = write_varint(out, zigzag_encode(int64_t(denominator) - previous_denominator));
+        }
+        else {
+            bool integer = denominator == 1;
+            out = write_varint(out, (zigzag_encode(numerator) << 1) | (integer ? 1 : 0));
+            if (!integer)
+                out = write_varint(out, uint64_t(denominator - 2));
+        }
+        previous_numerator = numerator;
+        previous_denominator = denominator;
+        return out;
+    }
+
+    // Encoder:
+
+    FractionEncoder::FractionEncoder(bool delta_in): delta(delta_in), previous_numerator(0), previous_denominator(1) {}
+
+    void FractionEncoder::reset() {
+        previous_numerator = 0;
+        previous_denominator = 1;
+    }
+
+    // Encodes values while they fit; pair(index, numerator, denominator) reads value index.
+    template <typename Pair>
+    static EncodeResult encode_values(bool delta, int& previous_numerator, int& previous_denominator,
+                                      size_t count, Pair pair, uint8_t* out, uint8_t* end) {
+        uint8_t scratch[max_encoded_fraction_size];
+        size_t index = 0;
+        for (; index < count; index++) {
+            int numerator = 0;
+            int denominator = 1;
+            pair(index, numerator, denominator);
+
+            // Near the end of the buffer, encode aside and copy if it fits.
+            bool roomy = size_t(end - out) >= max_encoded_fraction_size;
+            int new_previous_numerator = previous_numerator;
+            int new_previous_denominator = previous_denominator;
+            uint8_t* target = roomy ? out : scratch;
+            uint8_t* written = encode_value(target, delta, new_previous_numerator, new_previous_denominator, numerator, denominator);
+            size_t size = size_t(written - target);
+            if (!roomy) {
+                if (size > size_t(end - out))
+                    break;
+                copy(scratch, scratch + size, out);
+            }
+            out += size;
+            previous_numerator = new_previous_numerator;
+            previous_denominator = new_previous_denominator;
+        }
+        return {out, index};
+    }
+
+    EncodeResult FractionEncoder::encode(const Fraction* values, size_t count, uint8_t* out, uint8_t* end) {
+        return encode_values(delta, previous_numerator, previous_denominator, count,
+                             [values](size_t index, int& numerator, int& denominator) {
+                                 numerator = values[index].getNumerator();
+                                 denominator = values[index].getDenominator();
+                             }, out, end);
+    }
+
+    EncodeResult FractionEncoder::encode(const FractionColumn& column, size_t first, uint8_t* out, uint8_t* end) {
+        const vector<int>& numerators = column.getNumerators();
+        const vector<int>& denominators = column.getDenominators();
+        return encode_values(delta, previous_numerator, previous_denominator, column.size() - first,
+                             [&](size_t index, int& numerator, int& denominator) {
+                                 numerator = numerators[first + index];
+                                 denominator = denominators[first + index];
+                             }, out, end);
+    }
+
+    // Decoder:
+
+    FractionDecoder::FractionDecoder(bool delta_in): delta(delta_in), previous_numerator(0), previous_denominator(1) {}
+
+    void FractionDecoder::reset() {
+        previous_numerator = 0;
+        previous_denominator = 1;
+    }
+
+    // Returns nullptr without touching the state if the value is incomplete
+    // or corrupt; corrupt tells which.
+    const uint8_t* FractionDecoder::decode_one(const uint8_t* in, const uint8_t* end,
+                                               int& numerator, int& denominator, bool& corrupt) {
+        const int64_t int_min = numeric_limits<int>::min();
+        const int64_t int_max = numeric_limits<int>::max();
+
+        uint64_t head = 0;
+        const uint8_t* next = read_varint(in, end, head);
+        if (next == nullptr) {
+            corrupt = size_t(end - in) >= max_varint_size;
+            return nullptr;
+        }
+
+        bool flag = (head & 1) != 0;
+        int64_t number = zigzag_decode(head >> 1);
+        int64_t new_numerator = delta ? previous_numerator + number : number;
+        int64_t new_denominator = delta ? previous_denominator : 1;
+        if (!flag) {
+            uint64_t tail = 0;
+            next = read_varint(next, end, tail);
+            if (next == nullptr) {
+                corrupt = size_t(end - in) >= max_encoded_fraction_size;
+                return nullptr;
+            }
+            // A corrupt tail can be near +-2^63; an overflowing sum is
+            // corrupt too, marked by 0.
+            if (delta && __builtin_add_overflow(int64_t(previous_denominator), zigzag_decode(tail), &new_denominator))
+                new_denominator = 0;
+            else if (!delta)
+                new_denominator = tail > uint64_t(int_max) ? 0 : int64_t(tail) + 2;
+        }
+
+        if (new_numerator < int_min || new_numerator > int_max || new_denominator < 1 || new_denominator > int_max) {
+            corrupt = true;
+            return nullptr;
+        }
+        numerator = int(new_numerator);
+        denominator = int(new_denominator);
+        previous_numerator = numerator;
+        previous_denominator = denominator;
+        return next;
+    }
+
+    DecodeResult FractionDecoder::decode(const uint8_t* in, const uint8_t* end, Fraction* values, size_t capacity) {
+        size_t count = 0;
+        bool corrupt = false;
+        while (count < capacity) {
+            int numerator = 0;
+            int denominator = 1;
+            const uint8_t* next = decode_one(in, end, numerator, denominator, corrupt);
+            if (next == nullptr)
+                break;
+            values[count++] = Fraction(numerator, denominator);
+            in = next;
+        }
+        return {in, count, corrupt ? errc::illegal_byte_sequence : errc()};
+    }
+
+    DecodeResult FractionDecoder::decode(const uint8_t* in, const uint8_t* end, FractionColumn& column, size_t capacity) {
+        size_t count = 0;
+        bool corrupt = false;
+        while (count < capacity) {
+            int numerator = 0;
+            int denominator = 1;
+            const uint8_t* next = decode_one(in, end, numerator, denominator, corrupt);
+            if (next == nullptr)
+                break;
+            column.push_back_reduced(numerator, denominator);
+            count++;
+            in = next;
+        }
+        return {in, count, corrupt ? errc::illegal_byte_sequence : errc()};
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "FractionColumn.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace ariel
+{
+    // Streaming binary encoding for sequences of fractions.
+    //
+    // Each value starts with a varint head = zigzag(numerator) << 1 | flag.
+    // The flag says "the denominator is 1", and then nothing follows;
+    // otherwise a varint holds denominator - 2. Integers thus cost only the
+    // head, and the common small fractions two bytes.
+    //
+    // In delta mode, meant for sorted sequences, the head holds the numerator
+    // minus the previous numerator and the flag says "same denominator as the
+    // previous value"; otherwise a zigzag varint holds the denominator minus
+    // the previous one. Both ends must agree on the mode. A sequence starts
+    // from 0/1.
+    //
+    // No value takes more than max_encoded_fraction_size bytes.
+    constexpr size_t max_encoded_fraction_size = 10;
+
+    struct EncodeResult {
+        uint8_t* ptr;       // past the last byte written
+        size_t count;       // values encoded
+    };
+
+    struct DecodeResult {
+        const uint8_t* ptr; // past the last byte consumed
+        size_t count;       // values decoded
+        errc ec;            // errc::illegal_byte_sequence if the input is corrupt
+    };
+
+    class FractionEncoder {
+        private:
+            bool delta;
+            int previous_numerator;
+            int previous_denominator;
+
+        public:
+            // Constructors:
+            explicit FractionEncoder(bool delta_in = false);
+
+            // Encodes as many whole values as fit in [out, end).
+            EncodeResult encode(const Fraction* values, size_t count, uint8_t* out, uint8_t* end);
+            EncodeResult encode(const FractionColumn& column, size_t first, uint8_t* out, uint8_t* end);
+            // Starts a new sequence.
+            void reset();
+    };
+
+    class FractionDecoder {
+        private:
+            bool delta;
+            int previous_numerator;
+            int previous_denominator;
+
+            const uint8_t* decode_one(const uint8_t* in, const uint8_t* end, int& numerator, int& denominator, bool& corrupt);
+
+        public:
+            // Constructors:
+            explicit FractionDecoder(bool delta_in = false);
+
+            // Decodes up to capacity values from [in, end). A value cut off at
+            // the end of the input is left unconsumed, so the caller can
+            // append more bytes and continue from ptr.
+            DecodeResult decode(const uint8_t* in, const uint8_t* end, Fraction* values, size_t capacity);
+            // Same, appending to a column. Decoded pairs are taken to be
+            // reduced, as the encoder only sees reduced values.
+            DecodeResult decode(const uint8_t* in, const uint8_t* end, FractionColumn& column, size_t capacity);
+            // Starts a new sequence.
+            void reset();
+    };
+}
@@ -0,0 +1,65 @@
+#include "FractionColumn.hpp"
+
+namespace ariel
+{
+    // Constructors:
+
+    FractionColumn::FractionColumn(const vector<Fraction>& values) {
+        reserve(values.size());
+        for (const Fraction& value : values)
+            push_back(value);
+    }
+
+    // Size:
+
+    size_t FractionColumn::size() const {
+        return numerators.size();
+    }
+    bool FractionColumn::empty() const {
+        return numerators.empty();
+    }
+    void FractionColumn::reserve(size_t capacity) {
+        numerators.reserve(capacity);
+        denominators.reserve(capacity);
+    }
+    void FractionColumn::clear() {
+        numerators.clear();
+        denominators.clear();
+    }
+
+    // Insertion:
+
+    void FractionColumn::push_back(const Fraction& value) {
+        numerators.push_back(value.getNumerator());
+        denominators.push_back(value.getDenominator());
+    }
+    void FractionColumn::push_back_reduced(int numerator, int denominator) {
+        numerators.push_back(numerator);
+        denominators.push_back(denominator);
+    }
+    void FractionColumn::append_reduced(const int* numerators_in, const int* denominators_in, size_t count) {
+        numerators.insert(numerators.end(), numerators_in, numerators_in + count);
+        denominators.insert(denominators.end(), denominators_in, denominators_in + count);
+    }
+    void FractionColumn::append(const FractionColumn& other) {
+        numerators.insert(numerators.end(), other.numerators.begin(), other.numerators.end());
+        denominators.insert(denominators.end(), other.denominators.begin(), other.denominators.end());
+    }
+
+    // Element access:
+
+    Fraction FractionColumn::operator[](size_t index) const {
+        return Fraction(numerators[index], denominators[index]);
+    }
+    void FractionColumn::set(size_t index, const Fraction& value) {
+        numerators[index] = value.getNumerator();
+        denominators[index] = value.getDenominator();
+    }
+
+    const vector<int>& FractionColumn::getNumerators() const {
+        return numerators;
+    }
+    const vector<int>& FractionColumn::getDenominators() const {
+        return denominators;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Fraction.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace ariel
+{
+    // A column of fractions stored as a structure of arrays: all numerators
+    // in one contiguous array and all denominators in another, so batch
+    // kernels stream through plain ints. Every entry is in lowest terms with
+    // a positive denominator, the same invariant Fraction keeps.
+    class FractionColumn {
+        private:
+            vector<int> numerators;
+            vector<int> denominators;
+
+        public:
+            // Constructors:
+            FractionColumn() = default;
+            explicit FractionColumn(const vector<Fraction>& values);
+
+            size_t size() const;
+            bool empty() const;
+            void reserve(size_t capacity);
+            void clear();
+
+            void push_back(const Fraction& value);
+            // For producers that already hold a reduced pair with a positive
+            // denominator; the pair is stored as is.
+            void push_back_reduced(int numerator, int denominator);
+            void append_reduced(const int* numerators_in, const int* denominators_in, size_t count);
+            void append(const FractionColumn& other);
+
+            Fraction operator[](size_t index) const;
+            void set(size_t index, const Fraction& value);
+
+            // The arrays themselves:
+            const vector<int>& getNumerators() const;
+            const vector<int>& getDenominators() const;
+    };
+}
@@ -0,0 +1,151 @@
+#include "FractionCsv.hpp"
+#include "FractionChars.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace ariel
+{
+    // Below this many bytes per thread, splitting isn't worth a thread.
+    static const size_t min_chunk_size = size_t(1) << 20;
+
+    // What one thread parsed; rows in errors are relative to the chunk.
+    struct CsvChunk {
+        vector<FractionColumn> values;
+        vector<vector<CsvError>> errors;
+        size_t rows = 0;
+    };
+
+    static string_view trim(string_view field) {
+        while (!field.empty() && (field.front() == ' ' || field.front() == '\r'))
+            field.remove_prefix(1);
+        while (!field.empty() && (field.back() == ' ' || field.back() == '\r'))
+            field.remove_suffix(1);
+        return field;
+    }
+
+    // Splits off the first line of text (without its '\n').
+    static string_view next_line(string_view& text) {
+        size_t end = text.find('\n');
+        string_view line = text.substr(0, end);
+        text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+        return line;
+    }
+
+    // Splits off the next field of line (without its delimiter).
+    static string_view next_field(string_view& line, char delimiter) {
+        size_t end = line.find(delimiter);
+        string_view field = line.substr(0, end);
+        line.remove_prefix(end == string_view::npos ? line.size() : end + 1);
+        return field;
+    }
+
+    static bool parse_field(string_view field, Fraction& value, CsvErrorKind& kind) {
+        field = trim(field);
+        const char* first = field.data();
+        const char* last = first + field.size();
+        from_chars_result result = from_chars(first, last, value);
+
+        if (result.ec == errc() && result.ptr == last)
+            return true;
+        if (result.ec == errc::result_out_of_range && result.ptr == last)
+            kind = CsvErrorKind::OutOfRange;
+        // from_chars also says invalid_argument, pointing at the end, for an
+        // empty field; only a parsed n/0 is a zero denominator.
+        else if (result.ec == errc::invalid_argument && result.ptr == last && result.ptr != first)
+            kind = CsvErrorKind::ZeroDenominator;
+        else
+            kind = CsvErrorKind::Malformed;
+        return false;
+    }
+
+    static void parse_chunk(string_view text, char delimiter, size_t column_count, CsvChunk& chunk) {
+        chunk.values.resize(column_count);
+        chunk.errors.resize(column_count);
+
+        while (!text.empty()) {
+            string_view line = next_line(text);
+            if (trim(line).empty())
+                continue;
+
+            bool line_done = false;
+            for (size_t column = 0; column < column_count; column++) {
+                Fraction value;
+                CsvErrorKind kind = CsvErrorKind::MissingField;
+                bool valid = false;
+                if (!line_done) {
+                    line_done = line.find(delimiter) == string_view::npos;
+                    valid = parse_field(next_field(line, delimiter), value, kind);
+                }
+                if (!valid) {
+                    chunk.errors[column].push_back(CsvError{chunk.rows, kind});
+                    value = Fraction();
+                }
+                chunk.values[column].push_back(value);
+            }
+            chunk.rows++;
+        }
+    }
+
+    CsvTable parse_csv(string_view text, const CsvOptions& options) {
+        CsvTable table;
+
+        // The first non-empty line decides the delimiter and the column count.
+        string_view rest = text;
+        string_view first_line;
+        while (!rest.empty() && trim(first_line).empty())
+            first_line = next_line(rest);
+        if (trim(first_line).empty())
+            return table;
+
+        char delimiter = options.delimiter;
+        if (delimiter == '\0')
+            delimiter = first_line.find('\t') != string_view::npos ? '\t' : ',';
+
+        size_t column_count = size_t(count(first_line.begin(), first_line.end(), delimiter)) + 1;
+        table.columns.resize(column_count);
+        if (options.header) {
+            for (CsvColumn& column : table.columns)
+                column.name = string(trim(next_field(first_line, delimiter)));
+            text = rest;
+        }
+
+        // Chunks end right after a '\n', so no line is split between threads.
+        size_t threads = options.threads != 0 ? options.threads : max(1U, thread::hardware_concurrency());
+        threads = max(size_t(1), min(threads, text.size() / min_chunk_size));
+        vector<string_view> pieces;
+        while (!text.empty()) {
+            size_t cut = pieces.size() + 1 == threads ? text.size() : text.size() / (threads - pieces.size());
+            size_t end = text.find('\n', cut);
+            cut = end == string_view::npos ? text.size() : end + 1;
+            pieces.push_back(text.substr(0, cut));
+            text.remove_prefix(cut);
+        }
+
+        vector<CsvChunk> chunks(pieces.size());
+        vector<thread> workers;
+        for (size_t index = 1; index < pieces.size(); index++)
+            workers.emplace_back(parse_chunk, pieces[index], delimiter, column_count, ref(chunks[index]));
+        if (!pieces.empty())
+            parse_chunk(pieces[0], delimiter, column_count, chunks[0]);
+        for (thread& worker : workers)
+            worker.join();
+
+        // Stitch the chunks together in order.
+        for (const CsvChunk& chunk : chunks) {
+            for (size_t column = 0; column < column_count; column++) {
+                table.columns[column].values.append(chunk.values[column]);
+                for (const CsvError& error : chunk.errors[column])
+                    table.columns[column].errors.push_back(CsvError{table.rows + error.row, error.kind});
+            }
+            table.rows += chunk.rows;
+        }
+        return table;
+    }
+
+    CsvTable load_csv(const string& path, const CsvOptions& options) {
+        MappedFile file(path);
+        return parse_csv(file.view(), options);
+    }
+}
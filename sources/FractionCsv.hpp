@@ -0,0 +1,58 @@
+#pragma once
+
+#include "FractionColumn.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ariel
+{
+    // Why a field was rejected. The rules are those of operator>>.
+    enum class CsvErrorKind {
+        // Not a fraction; operator>> throws "Invalid input"
+        Malformed,
+        // operator>> throws "Denominator can't be zero!"
+        ZeroDenominator,
+        // Doesn't fit in a Fraction
+        OutOfRange,
+        // The row has fewer fields than there are columns
+        MissingField
+    };
+
+    struct CsvError {
+        size_t row; // data row, the first row after the header is 0
+        CsvErrorKind kind;
+    };
+
+    struct CsvColumn {
+        string name;                // from the header row, empty without one
+        FractionColumn values;      // one entry per row; 0/1 where the field was rejected
+        vector<CsvError> errors;    // in row order
+    };
+
+    struct CsvTable {
+        vector<CsvColumn> columns;
+        size_t rows = 0;
+    };
+
+    struct CsvOptions {
+        // ',' or '\t'; '\0' picks '\t' if the first line has one, ',' otherwise.
+        char delimiter = '\0';
+        // Whether the first line holds column names.
+        bool header = false;
+        // Parser threads; 0 means one per hardware thread.
+        size_t threads = 0;
+    };
+
+    // Loads every column of a CSV/TSV file of fractions. The file is memory
+    // mapped, split into chunks at line boundaries and the chunks are parsed
+    // in parallel with from_chars; fields are string_views into the mapping.
+    // The number of columns is taken from the first line, extra fields are
+    // ignored and empty lines are skipped. Rejected fields don't stop the load,
+    // they are reported per column. Throws runtime_error if the file can't be read.
+    CsvTable load_csv(const string& path, const CsvOptions& options = CsvOptions());
+    // Same for text that is already in memory.
+    CsvTable parse_csv(string_view text, const CsvOptions& options = CsvOptions());
+}
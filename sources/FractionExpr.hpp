@@ -0,0 +1,300 @@
+#pragma once
+
+#include "Fraction.hpp"
+
+#include <concepts>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+// Expression templates over Fraction arithmetic.
+//
+// Wrapping one operand with expr::fuse() turns the rest of the expression into
+// a tree instead of a chain of reduced temporaries:
+//
+//     Fraction c = expr::fuse(a) + b - 1;
+//     Fraction d = (expr::fuse(x) * y + z) / w;
+//
+// The tree is evaluated when it is converted to a Fraction. Intermediates are
+// kept as unreduced 128 bit pairs, common factors are cancelled only when a
+// 128 bit intermediate would overflow, and the result is normalized once.
+// Only the final value has to fit in an int, so an expression can succeed
+// where the same chain of Fraction operators throws overflow_error.
+//
+// Operands are copied into the tree, so a tree may outlive the fractions it
+// was built from.
+namespace ariel
+{
+    namespace expr
+    {
+        using wide = __int128;
+
+        // Exact value of a subtree. denominator > 0, not necessarily reduced.
+        struct Value {
+            wide numerator;
+            wide denominator;
+        };
+
+        namespace detail
+        {
+            inline wide abs(wide value) {
+                return value < 0 ? -value : value;
+            }
+
+            inline wide gcd(wide lhs, wide rhs) {
+                lhs = detail::abs(lhs);
+                rhs = detail::abs(rhs);
+                while (rhs != 0) {
+                    wide remainder = lhs % rhs;
+                    lhs = rhs;
+                    rhs = remainder;
+                }
+                return lhs;
+            }
+
+            inline void reduce(Value& value) {
+                wide divisor = detail::gcd(value.numerator, value.denominator);
+                if (divisor > 1) {
+                    value.numerator /= divisor;
+                    value.denominator /= divisor;
+                }
+            }
+
+            // (lhs.numerator * rhs_numerator) / (lhs.denominator * rhs_denominator)
+            // rhs_denominator must be positive.
+            inline Value multiply(Value lhs, wide rhs_numerator, wide rhs_denominator) {
+                Value result{};
+                if (!__builtin_mul_overflow(lhs.numerator, rhs_numerator, &result.numerator) &&
+                    !__builtin_mul_overflow(lhs.denominator, rhs_denominator, &result.denominator))
+                    return result;
+
+                // Cancel across the operands before giving up.
+                wide left_cross = detail::gcd(lhs.numerator, rhs_denominator);
+                wide right_cross = detail::gcd(rhs_numerator, lhs.denominator);
+                if (left_cross > 1) {
+                    lhs.numerator /= left_cross;
+                    rhs_denominator /= left_cross;
+                }
+                if (right_cross > 1) {
+                    rhs_numerator /= right_cross;
+                    lhs.denominator /= right_cross;
+                }
+                reduce(lhs);
+
+                if (__builtin_mul_overflow(lhs.numerator, rhs_numerator, &result.numerator) ||
+                    __builtin_mul_overflow(lhs.denominator, rhs_denominator, &result.denominator))
+                    throw overflow_error("Integer overflow! ");
+                return result;
+            }
+
+            // lhs + sign * rhs
+            inline Value add(Value lhs, Value rhs, int sign) {
+                Value result{};
+                if (lhs.denominator == rhs.denominator) {
+                    result.denominator = lhs.denominator;
+                    if (!__builtin_add_overflow(lhs.numerator, sign * rhs.numerator, &result.numerator))
+                        return result;
+                }
+                else {
+                    wide left = 0;
+                    wide right = 0;
+                    if (!__builtin_mul_overflow(lhs.numerator, rhs.denominator, &left) &&
+                        !__builtin_mul_overflow(rhs.numerator, lhs.denominator, &right) &&
+                        !__builtin_mul_overflow(lhs.denominator, rhs.denominator, &result.denominator) &&
+                        !__builtin_add_overflow(left, sign * right, &result.numerator))
+                        return result;
+                }
+
+                // Reduce both sides and work over the lcm of the denominators.
+                reduce(lhs);
+                reduce(rhs);
+                wide common = detail::gcd(lhs.denominator, rhs.denominator);
+                wide left_scale = rhs.denominator / common;
+                wide right_scale = lhs.denominator / common;
+                wide left = 0;
+                wide right = 0;
+                if (__builtin_mul_overflow(lhs.numerator, left_scale, &left) ||
+                    __builtin_mul_overflow(rhs.numerator, right_scale, &right) ||
+                    __builtin_mul_overflow(lhs.denominator, left_scale, &result.denominator) ||
+                    __builtin_add_overflow(left, sign * right, &result.numerator))
+                    throw overflow_error("Integer overflow! ");
+                return result;
+            }
+
+            // Same truncation as Fraction(float).
+            inline Value from_float(float number) {
+                const int scale = 1000;
+                return Value{static_cast<int>(number * scale), scale};
+            }
+
+            inline Fraction to_fraction(Value value) {
+                const wide int_min = numeric_limits<int>::min();
+                const wide int_max = numeric_limits<int>::max();
+                auto fits = [&](const Value& candidate) {
+                    return candidate.numerator >= int_min && candidate.numerator <= int_max &&
+                           candidate.denominator <= int_max;
+                };
+
+                // The Fraction constructor reduces, so only normalize here
+                // when the unreduced pair would not fit.
+                if (!fits(value)) {
+                    reduce(value);
+                    if (!fits(value))
+                        throw overflow_error("Integer overflow! ");
+                }
+                return Fraction(static_cast<int>(value.numerator), static_cast<int>(value.denominator));
+            }
+        }
+
+        // Expression nodes:
+
+        template <typename T>
+        concept Node = requires(const T& node) {
+            { node.evaluate() } -> same_as<Value>;
+        };
+
+        template <typename T>
+        concept Scalar = is_arithmetic_v<T> && !same_as<T, bool>;
+
+        template <typename T>
+        concept Operand = Node<T> || same_as<T, Fraction> || Scalar<T>;
+
+        template <typename Derived>
+        class Expression {
+            public:
+                // Evaluates the whole tree with a single final normalization.
+                Fraction eval() const {
+                    return detail::to_fraction(static_cast<const Derived&>(*this).evaluate());
+                }
+                operator Fraction() const {
+                    return eval();
+                }
+
+                friend ostream& operator<<(ostream& output, const Derived& node) {
+                    return output << node.eval();
+                }
+        };
+
+        class Leaf: public Expression<Leaf> {
+            private:
+                Value value;
+
+            public:
+                explicit Leaf(const Fraction& fraction): value{fraction.getNumerator(), fraction.getDenominator()} {}
+                template <Scalar T>
+                explicit Leaf(T number): value{} {
+                    if constexpr (is_floating_point_v<T>)
+                        value = detail::from_float(static_cast<float>(number));
+                    else
+                        value = Value{static_cast<wide>(number), 1};
+                }
+
+                Value evaluate() const {
+                    return value;
+                }
+        };
+
+        struct Add {
+            static Value apply(const Value& lhs, const Value& rhs) {
+                return detail::add(lhs, rhs, 1);
+            }
+        };
+        struct Subtract {
+            static Value apply(const Value& lhs, const Value& rhs) {
+                return detail::add(lhs, rhs, -1);
+            }
+        };
+        struct Multiply {
+            static Value apply(const Value& lhs, const Value& rhs) {
+                return detail::multiply(lhs, rhs.numerator, rhs.denominator);
+            }
+        };
+        struct Divide {
+            static Value apply(const Value& lhs, const Value& rhs) {
+                if (rhs.numerator == 0)
+                    throw runtime_error("Can't divide by zero!");
+
+                if (rhs.numerator < 0)
+                    return detail::multiply(lhs, -rhs.denominator, -rhs.numerator);
+                return detail::multiply(lhs, rhs.denominator, rhs.numerator);
+            }
+        };
+
+        template <typename Op, Node Lhs, Node Rhs>
+        class Binary: public Expression<Binary<Op, Lhs, Rhs>> {
+            private:
+                Lhs lhs;
+                Rhs rhs;
+
+            public:
+                Binary(const Lhs& lhs_in, const Rhs& rhs_in): lhs(lhs_in), rhs(rhs_in) {}
+
+                Value evaluate() const {
+                    return Op::apply(lhs.evaluate(), rhs.evaluate());
+                }
+        };
+
+        template <Node Inner>
+        class Negate: public Expression<Negate<Inner>> {
+            private:
+                Inner operand;
+
+            public:
+                explicit Negate(const Inner& operand_in): operand(operand_in) {}
+
+                Value evaluate() const {
+                    Value value = operand.evaluate();
+                    value.numerator = -value.numerator;
+                    return value;
+                }
+        };
+
+        // Entry point: starts an expression from a Fraction.
+        inline Leaf fuse(const Fraction& fraction) {
+            return Leaf(fraction);
+        }
+
+        template <Operand T>
+        auto as_node(const T& operand) {
+            if constexpr (Node<T>)
+                return operand;
+            else
+                return Leaf(operand);
+        }
+
+        template <typename Op, Operand Lhs, Operand Rhs>
+        auto make_binary(const Lhs& lhs, const Rhs& rhs) {
+            using LhsNode = decltype(as_node(lhs));
+            using RhsNode = decltype(as_node(rhs));
+            return Binary<Op, LhsNode, RhsNode>(as_node(lhs), as_node(rhs));
+        }
+
+        // Operators: at least one side must already be a node, so plain
+        // Fraction arithmetic is never affected.
+
+        template <Operand Lhs, Operand Rhs>
+            requires (Node<Lhs> || Node<Rhs>)
+        auto operator+(const Lhs& lhs, const Rhs& rhs) {
+            return make_binary<Add>(lhs, rhs);
+        }
+        template <Operand Lhs, Operand Rhs>
+            requires (Node<Lhs> || Node<Rhs>)
+        auto operator-(const Lhs& lhs, const Rhs& rhs) {
+            return make_binary<Subtract>(lhs, rhs);
+        }
+        template <Operand Lhs, Operand Rhs>
+            requires (Node<Lhs> || Node<Rhs>)
+        auto operator*(const Lhs& lhs, const Rhs& rhs) {
+            return make_binary<Multiply>(lhs, rhs);
+        }
+        template <Operand Lhs, Operand Rhs>
+            requires (Node<Lhs> || Node<Rhs>)
+        auto operator/(const Lhs& lhs, const Rhs& rhs) {
+            return make_binary<Divide>(lhs, rhs);
+        }
+        template <Node Inner>
+        auto operator-(const Inner& operand) {
+            return Negate<Inner>(operand);
+        }
+    }
+}
@@ -0,0 +1,398 @@
+#include "FractionFile.hpp"
+#include "Varint.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace ariel
+{
+    static const char magic[8] = {'F', 'R', 'A', 'C', 'C', 'O', 'L', '1'};
+    static const uint32_t format_version = 1;
+    static const size_t header_size = 32;
+
+    // Little endian loads and stores:
+
+    static void store32(uint8_t* out, uint32_t value) {
+        for (int index = 0; index < 4; index++)
+            out[index] = uint8_t(value >> (8 * index));
+    }
+    static void store64(uint8_t* out, uint64_t value) {
+        for (int index = 0; index < 8; index++)
+            out[index] = uint8_t(value >> (8 * index));
+    }
+    static uint32_t load32(const uint8_t* in) {
+        uint32_t value = 0;
+        for (int index = 3; index >= 0; index--)
+            value = (value << 8) | in[index];
+        return value;
+    }
+    static uint64_t load64(const uint8_t* in) {
+        uint64_t value = 0;
+        for (int index = 7; index >= 0; index--)
+            value = (value << 8) | in[index];
+        return value;
+    }
+
+    static void corrupt() {
+        throw runtime_error("Corrupt fraction file");
+    }
+
+    // Writer:
+
+    // The index width byte of blocks that store their denominators as
+    // varints, in files without a dictionary.
+    static const unsigned raw_width = 0xFF;
+
+    // Bits needed for an index below size; 0 when there is only one choice.
+    // Without a dictionary the denominators are stored raw.
+    static unsigned index_width(size_t size) {
+        return size == 0 ? raw_width : size == 1 ? 0 : unsigned(bit_width(size - 1));
+    }
+
+    static void encode_block(const int* numerators, const uint32_t* indices, size_t length,
+                             unsigned width, vector<uint8_t>& out) {
+        out.clear();
+        out.push_back(uint8_t(width));
+
+        uint8_t varint[max_varint_size];
+        for (size_t index = 0; index < length; index++) {
+            uint8_t* end = write_varint(varint, zigzag_encode(numerators[index]));
+            out.insert(out.end(), varint, end);
+        }
+
+        // Raw blocks hold the denominators themselves in indices.
+        if (width == raw_width) {
+            for (size_t index = 0; index < length; index++) {
+                uint8_t* end = write_varint(varint, indices[index]);
+                out.insert(out.end(), varint, end);
+            }
+            return;
+        }
+
+        uint64_t bits = 0;
+        unsigned pending = 0;
+        for (size_t index = 0; index < length && width > 0; index++) {
+            bits |= uint64_t(indices[index]) << pending;
+            pending += width;
+            while (pending >= 8) {
+                out.push_back(uint8_t(bits));
+                bits >>= 8;
+                pending -= 8;
+            }
+        }
+        if (pending > 0)
+            out.push_back(uint8_t(bits));
+    }
+
+    void write_fraction_file(const string& path, const FractionColumn& column, size_t block_size) {
+        vector<int> dictionary(column.getDenominators());
+        sort(dictionary.begin(), dictionary.end());
+        dictionary.erase(unique(dictionary.begin(), dictionary.end()), dictionary.end());
+
+        FractionFileWriter writer(path, dictionary, column.size(), block_size);
+        const vector<int>& numerators = column.getNumerators();
+        const vector<int>& denominators = column.getDenominators();
+        for (size_t index = 0; index < column.size(); index++)
+            writer.push_back(numerators[index], denominators[index]);
+        writer.finish();
+    }
+
+    // Streaming writer:
+
+    FractionFileWriter::FractionFileWriter(const string& path_in, vector<int> denominators, size_t max_count_in,
+                                           size_t block_size_in):
+        path(path_in), dictionary(move(denominators)), width(0), block_size(block_size_in), max_count(max_count_in),
+        count(0), offsets_position(0), position(0), finished(false) {
+        if (block_size == 0)
+            throw invalid_argument("Block size can't be zero!");
+        // The header has 32 bits for these.
+        if (block_size > numeric_limits<uint32_t>::max() ||
+            max_count / block_size >= numeric_limits<uint32_t>::max() ||
+            dictionary.size() > numeric_limits<uint32_t>::max())
+            throw invalid_argument("Too many values for a fraction file");
+        if (any_of(dictionary.begin(), dictionary.end(), [](int denominator) { return denominator <= 0; }))
+            throw invalid_argument("Denominators must be positive");
+
+        sort(dictionary.begin(), dictionary.end());
+        dictionary.erase(unique(dictionary.begin(), dictionary.end()), dictionary.end());
+        width = index_width(dictionary.size());
+
+        output.open(path, ios::binary | ios::trunc);
+        if (!output)
+            throw runtime_error("Can't create " + path);
+
+        // The header is written by finish(), once the count is known.
+        uint8_t header[header_size] = {};
+        output.write(reinterpret_cast<const char*>(header), header_size);
+
+        vector<uint8_t> table(4 * dictionary.size());
+        for (size_t index = 0; index < dictionary.size(); index++)
+            store32(table.data() + 4 * index, uint32_t(dictionary[index]));
+        output.write(reinterpret_cast<const char*>(table.data()), streamsize(table.size()));
+
+        // Room for the offsets of max_count values; they are written last too.
+        offsets_position = header_size + table.size();
+        vector<uint8_t> reserved(8 * ((max_count + block_size - 1) / block_size + 1));
+        output.write(reinterpret_cast<const char*>(reserved.data()), streamsize(reserved.size()));
+        position = offsets_position + reserved.size();
+
+        numerators.reserve(block_size);
+        indices.reserve(block_size);
+    }
+
+    FractionFileWriter::~FractionFileWriter() {
+        if (!finished)
+            discard();
+    }
+
+    void FractionFileWriter::discard() {
+        finished = true;
+        output.close();
+        remove(path.c_str());
+    }
+
+    void FractionFileWriter::push_back(int numerator, int denominator) {
+        uint32_t index = 0;
+        if (dictionary.empty()) {
+            if (denominator <= 0)
+                throw invalid_argument("Denominator must be positive");
+            index = uint32_t(denominator);
+        }
+        else {
+            auto entry = lower_bound(dictionary.begin(), dictionary.end(), denominator);
+            if (entry == dictionary.end() || *entry != denominator)
+                throw invalid_argument("Denominator not in the dictionary");
+            index = uint32_t(entry - dictionary.begin());
+        }
+        if (count == max_count || finished)
+            throw invalid_argument("More values than the writer was made for");
+        uint32_t magnitude = numerator < 0 ? 0U - uint32_t(numerator) : uint32_t(numerator);
+        if (gcd(magnitude, uint32_t(denominator)) != 1)
+            throw invalid_argument("Fraction not in lowest terms");
+
+        numerators.push_back(numerator);
+        indices.push_back(index);
+        count++;
+        if (numerators.size() == block_size)
+            flush_block();
+    }
+
+    void FractionFileWriter::push_back(const Fraction& value) {
+        push_back(value.getNumerator(), value.getDenominator());
+    }
+
+    size_t FractionFileWriter::size() const {
+        return count;
+    }
+
+    void FractionFileWriter::flush_block() {
+        encode_block(numerators.data(), indices.data(), numerators.size(), width, encoded);
+        offsets.push_back(position);
+        output.write(reinterpret_cast<const char*>(encoded.data()), streamsize(encoded.size()));
+        position += encoded.size();
+        numerators.clear();
+        indices.clear();
+    }
+
+    void FractionFileWriter::finish() {
+        if (finished)
+            return;
+        finished = true;
+        if (!numerators.empty())
+            flush_block();
+        size_t block_count = offsets.size();
+        offsets.push_back(position);
+
+        uint8_t header[header_size] = {};
+        memcpy(header, magic, sizeof(magic));
+        store32(header + 8, format_version);
+        store32(header + 12, uint32_t(block_size));
+        store64(header + 16, count);
+        store32(header + 24, uint32_t(dictionary.size()));
+        store32(header + 28, uint32_t(block_count));
+        output.seekp(0);
+        output.write(reinterpret_cast<const char*>(header), header_size);
+
+        vector<uint8_t> table(8 * offsets.size());
+        for (size_t block = 0; block < offsets.size(); block++)
+            store64(table.data() + 8 * block, offsets[block]);
+        output.seekp(streamoff(offsets_position));
+        output.write(reinterpret_cast<const char*>(table.data()), streamsize(table.size()));
+
+        output.close();
+        if (!output) {
+            discard();
+            throw runtime_error("Can't write " + path);
+        }
+    }
+
+    // Reader:
+
+    FractionFileReader::FractionFileReader(const string& path):
+        file(path), count(0), block_size(0), block_count(0), dictionary_size(0), dictionary(nullptr), offsets(nullptr) {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(file.data());
+        if (file.size() < header_size || memcmp(data, magic, sizeof(magic)) != 0)
+            throw runtime_error("Not a fraction file: " + path);
+        if (load32(data + 8) != format_version)
+            throw runtime_error("Unsupported fraction file version: " + path);
+
+        block_size = load32(data + 12);
+        count = load64(data + 16);
+        dictionary_size = load32(data + 24);
+        block_count = load32(data + 28);
+        // Every value takes at least a byte, which also keeps the sum below
+        // from wrapping.
+        if (block_size == 0 || count > file.size() || block_count != (count + block_size - 1) / block_size)
+            corrupt();
+        // A lone block is only as long as the count, whatever block size it
+        // was written with; readers size their buffers by blockSize().
+        block_size = min(block_size, max(count, size_t(1)));
+        if (header_size + 4 * dictionary_size + 8 * (block_count + 1) > file.size())
+            corrupt();
+
+        dictionary = data + header_size;
+        offsets = dictionary + 4 * dictionary_size;
+        for (size_t index = 0; index < dictionary_size; index++)
+            if (denominator_at(index) <= 0)
+                corrupt();
+        for (size_t block = 0; block <= block_count; block++)
+            if (block_offset(block) > file.size() || (block > 0 && block_offset(block) < block_offset(block - 1)))
+                corrupt();
+        // And each block a byte for the index width; so no block is longer
+        // than the file, whatever block_size says.
+        for (size_t block = 0; block < block_count; block++)
+            if (blockLength(block) >= block_offset(block + 1) - block_offset(block))
+                corrupt();
+    }
+
+    int FractionFileReader::denominator_at(size_t index) const {
+        return int(load32(dictionary + 4 * index));
+    }
+    size_t FractionFileReader::block_offset(size_t block) const {
+        return size_t(load64(offsets + 8 * block));
+    }
+
+    size_t FractionFileReader::size() const {
+        return count;
+    }
+    size_t FractionFileReader::blockSize() const {
+        return block_size;
+    }
+    size_t FractionFileReader::blockCount() const {
+        return block_count;
+    }
+    size_t FractionFileReader::blockLength(size_t block) const {
+        return block + 1 < block_count ? block_size : count - block * block_size;
+    }
+
+    size_t FractionFileReader::decodeBlock(size_t block, int* numerators, int* denominators) const {
+        if (block >= block_count)
+            throw out_of_range("No such block");
+
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(file.data());
+        const uint8_t* in = data + block_offset(block);
+        const uint8_t* end = data + block_offset(block + 1);
+        size_t length = blockLength(block);
+        if (in == end)
+            corrupt();
+
+        unsigned width = *in++;
+        if (width != index_width(dictionary_size))
+            corrupt();
+
+        for (size_t index = 0; index < length; index++) {
+            uint64_t encoded = 0;
+            in = read_varint(in, end, encoded);
+            if (in == nullptr)
+                corrupt();
+            int64_t numerator = zigzag_decode(encoded);
+            if (numerator < numeric_limits<int>::min() || numerator > numeric_limits<int>::max())
+                corrupt();
+            numerators[index] = int(numerator);
+        }
+
+        if (width == raw_width) {
+            for (size_t index = 0; index < length; index++) {
+                uint64_t denominator = 0;
+                in = read_varint(in, end, denominator);
+                if (in == nullptr || denominator == 0 || denominator > uint64_t(numeric_limits<int>::max()))
+                    corrupt();
+                denominators[index] = int(denominator);
+            }
+        }
+        else if (width == 0)
+            fill(denominators, denominators + length, denominator_at(0));
+        else
+            decode_indices(in, end, width, length, denominators);
+
+        // Columns take the values as they are, so they must be in lowest terms.
+        for (size_t index = 0; index < length; index++) {
+            uint32_t magnitude = numerators[index] < 0 ? 0U - uint32_t(numerators[index]) : uint32_t(numerators[index]);
+            if (gcd(magnitude, uint32_t(denominators[index])) != 1)
+                corrupt();
+        }
+        return length;
+    }
+
+    void FractionFileReader::decode_indices(const uint8_t* in, const uint8_t* end, unsigned width, size_t length,
+                                            int* denominators) const {
+        if (size_t(end - in) < (length * width + 7) / 8)
+            corrupt();
+        uint64_t bits = 0;
+        unsigned available = 0;
+        const uint64_t mask = (uint64_t(1) << width) - 1;
+        for (size_t index = 0; index < length; index++) {
+            while (available < width) {
+                bits |= uint64_t(*in++) << available;
+                available += 8;
+            }
+            size_t entry = size_t(bits & mask);
+            bits >>= width;
+            available -= width;
+            if (entry >= dictionary_size)
+                corrupt();
+            denominators[index] = denominator_at(entry);
+        }
+    }
+
+    void FractionFileReader::decodeBlock(size_t block, FractionColumn& column) const {
+        vector<int> numerators(blockLength(block));
+        vector<int> denominators(numerators.size());
+        decodeBlock(block, numerators.data(), denominators.data());
+        column.append_reduced(numerators.data(), denominators.data(), numerators.size());
+    }
+
+    void FractionFileReader::readInto(FractionColumn& column) const {
+        column.reserve(column.size() + count);
+        vector<int> numerators(block_size);
+        vector<int> denominators(block_size);
+        for (size_t block = 0; block < block_count; block++) {
+            size_t length = decodeBlock(block, numerators.data(), denominators.data());
+            column.append_reduced(numerators.data(), denominators.data(), length);
+        }
+    }
+
+    vector<int> FractionFileReader::denominators() const {
+        vector<int> result(dictionary_size);
+        for (size_t index = 0; index < dictionary_size; index++)
+            result[index] = denominator_at(index);
+        return result;
+    }
+
+    void FractionFileReader::prefetchBlock(size_t block) const {
+        if (block < block_count)
+            file.willNeed(block_offset(block), block_offset(block + 1) - block_offset(block));
+    }
+
+    FractionColumn FractionFileReader::read() const {
+        FractionColumn column;
+        readInto(column);
+        return column;
+    }
+}
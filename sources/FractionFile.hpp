@@ -0,0 +1,144 @@
+#pragma once
+
+#include "FractionColumn.hpp"
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ariel
+{
+    // Binary file format for one column of fractions. Little endian throughout.
+    //
+    //   header      "FRACCOL1", uint32 version, uint32 block size (values per
+    //               block), uint64 value count, uint32 dictionary size,
+    //               uint32 block count                                 32 bytes
+    //   dictionary  the distinct denominators, int32 each, ascending
+    //   offsets     uint64 file offset of each block, and of the end of the last
+    //   blocks      uint8 index width in bits, then the block's numerators as
+    //               zigzag varints, then its denominators as dictionary
+    //               indices, bit packed from the low bit up
+    //
+    // Every block but the last holds exactly block size values, so any block
+    // can be found and decoded on its own. Real data tends to use few distinct
+    // denominators, which the dictionary turns into a few bits per value. A
+    // file with values but no dictionary stores the denominators themselves,
+    // as varints after the numerators, with an index width of 0xFF.
+    constexpr size_t fraction_file_default_block_size = 4096;
+
+    // Writes column to path, replacing the file. Throws runtime_error on I/O errors.
+    void write_fraction_file(const string& path, const FractionColumn& column,
+                             size_t block_size = fraction_file_default_block_size);
+
+    // Streaming writer, for files too big to hold as a column first. The
+    // dictionary and the offsets come before the blocks, so the denominators
+    // that will be written and an upper bound on the number of values must
+    // be given up front. With no denominators, any positive denominator may
+    // be written and is stored raw, for when the dictionary would be too big
+    // to hold. If fewer values are written, the unused offset entries are
+    // left as padding before the first block; readers find blocks through
+    // the offsets, so the file is still valid.
+    class FractionFileWriter {
+        private:
+            string path;
+            ofstream output;
+            vector<int> dictionary;
+            unsigned width;
+            size_t block_size;
+            size_t max_count;
+            size_t count;
+            size_t offsets_position;
+            uint64_t position;
+            vector<uint64_t> offsets;
+            // The block being filled:
+            vector<int> numerators;
+            vector<uint32_t> indices;
+            vector<uint8_t> encoded;
+            bool finished;
+
+            void flush_block();
+            // Closes and removes the unfinished file.
+            void discard();
+
+        public:
+            // Constructors: throw invalid_argument if block_size is zero or
+            // the counts don't fit the header's 32 bits, or a denominator
+            // isn't positive.
+            FractionFileWriter(const string& path_in, vector<int> denominators, size_t max_count_in,
+                               size_t block_size_in = fraction_file_default_block_size);
+            FractionFileWriter(const FractionFileWriter& other) = delete;
+            FractionFileWriter& operator=(const FractionFileWriter& other) = delete;
+            // Removes the file if finish() wasn't called, so that a writer
+            // dropped by an exception leaves no valid looking partial file.
+            ~FractionFileWriter();
+
+            // Appends a value in lowest terms. Throws invalid_argument if it
+            // isn't, if the denominator wasn't given to the constructor (or
+            // isn't positive, without a dictionary) or if max_count values
+            // were written already.
+            void push_back(int numerator, int denominator);
+            void push_back(const Fraction& value);
+            size_t size() const;
+
+            // Writes the last block, the header and the offsets, and closes
+            // the file. Throws runtime_error on I/O errors, after removing
+            // the file.
+            void finish();
+    };
+
+    // Zero-copy reader: the file is memory mapped and blocks are decoded
+    // straight from the mapping. Throws runtime_error if the file can't be
+    // read or isn't a valid fraction file.
+    class FractionFileReader {
+        private:
+            MappedFile file;
+            size_t count;
+            size_t block_size;
+            size_t block_count;
+            size_t dictionary_size;
+            const uint8_t* dictionary;
+            const uint8_t* offsets;
+
+            int denominator_at(size_t index) const;
+            size_t block_offset(size_t block) const;
+            void decode_indices(const uint8_t* in, const uint8_t* end, unsigned width, size_t length,
+                                int* denominators) const;
+
+        public:
+            // Constructors:
+            explicit FractionFileReader(const string& path);
+
+            size_t size() const;
+            size_t blockSize() const;
+            size_t blockCount() const;
+            size_t blockLength(size_t block) const;
+            // The dictionary: every denominator in the file, ascending; empty
+            // if the file stores them raw.
+            vector<int> denominators() const;
+            // Starts reading a block from disk in the background.
+            void prefetchBlock(size_t block) const;
+
+            // Decodes one block into caller provided arrays of at least
+            // blockLength(block) ints. Returns the number of values written.
+            size_t decodeBlock(size_t block, int* numerators, int* denominators) const;
+            // Appends one block, or the whole file, to a column.
+            void decodeBlock(size_t block, FractionColumn& column) const;
+            void readInto(FractionColumn& column) const;
+            FractionColumn read() const;
+
+            // Calls callback(const Fraction&) for every value, in order.
+            template <typename Callback>
+            void forEach(Callback callback) const {
+                vector<int> numerators(block_size);
+                vector<int> denominators(block_size);
+                for (size_t block = 0; block < block_count; block++) {
+                    size_t length = decodeBlock(block, numerators.data(), denominators.data());
+                    for (size_t index = 0; index < length; index++)
+                        callback(Fraction(numerators[index], denominators[index]));
+                }
+            }
+    };
+}
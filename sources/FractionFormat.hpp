@@ -0,0 +1,244 @@
+#pragma once
+
+#include "Fraction.hpp"
+#include "FractionChars.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <version>
+
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+
+namespace ariel
+{
+    // A parsed format spec for a Fraction, the part after ':' in "{:...}":
+    //     ""  "r"     ratio               7/3
+    //     "m"         mixed number        2 1/3
+    //     "f" ".Nf"   fixed decimal       2.333 (N digits, default 3, rounded)
+    //     ".N"        same as ".Nf"
+    //     "p" ".Np"   repeating decimal   2.(3) or 0.58(3); at most N digits
+    //                 after the point (default 64), a cut off repetend ends in "...)"
+    struct FractionFormatSpec {
+        enum class Style { Ratio, Mixed, Fixed, Repeating };
+
+        static constexpr int default_fixed_precision = 3;
+        static constexpr int default_repeating_precision = 64;
+
+        Style style = Style::Ratio;
+        int precision = -1; // -1: the style's default
+    };
+
+    template <typename InputIt>
+    struct FormatSpecResult {
+        InputIt end;        // the '}' (or last) that ended the spec
+        bool valid;
+    };
+
+    // Parses a spec from [first, last), stopping at '}' or last. Takes any
+    // char iterator, so std::formatter can hand over its parse context's.
+    template <typename InputIt>
+    constexpr FormatSpecResult<InputIt> parse_format_spec(InputIt first, InputIt last, FractionFormatSpec& spec) {
+        spec = FractionFormatSpec();
+        const int max_precision = 1000000;
+
+        if (first != last && *first == '.') {
+            first++;
+            if (first == last || *first < '0' || *first > '9')
+                return {first, false};
+            int precision = 0;
+            for (; first != last && *first >= '0' && *first <= '9'; first++) {
+                precision = precision * 10 + (*first - '0');
+                if (precision > max_precision)
+                    return {first, false};
+            }
+            spec.precision = precision;
+            spec.style = FractionFormatSpec::Style::Fixed;
+        }
+
+        if (first != last && *first != '}') {
+            switch (*first) {
+                case 'r':
+                    spec.style = FractionFormatSpec::Style::Ratio;
+                    break;
+                case 'm':
+                    spec.style = FractionFormatSpec::Style::Mixed;
+                    break;
+                case 'f':
+                    spec.style = FractionFormatSpec::Style::Fixed;
+                    break;
+                case 'p':
+                    spec.style = FractionFormatSpec::Style::Repeating;
+                    break;
+                default:
+                    return {first, false};
+            }
+            first++;
+        }
+
+        // A precision only makes sense for the decimal styles.
+        if (spec.precision >= 0 && (spec.style == FractionFormatSpec::Style::Ratio ||
+                                    spec.style == FractionFormatSpec::Style::Mixed))
+            return {first, false};
+        if (first != last && *first != '}')
+            return {first, false};
+        return {first, true};
+    }
+
+    namespace detail
+    {
+        template <typename OutputIt>
+        OutputIt copy_chars(OutputIt out, const char* first, const char* last) {
+            for (; first != last; first++)
+                *out++ = *first;
+            return out;
+        }
+
+        template <typename OutputIt>
+        OutputIt write_unsigned(OutputIt out, uint64_t value) {
+            char buffer[20];
+            to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            return copy_chars(out, buffer, result.ptr);
+        }
+
+        // Fixed point with rounding half away from zero, like to_chars with
+        // FractionFormat::Decimal, but for any number of digits: a first pass
+        // finds where the rounding carry stops, the second writes the digits.
+        template <typename OutputIt>
+        OutputIt write_fixed(OutputIt out, uint32_t numerator, uint32_t denominator, int precision) {
+            uint64_t whole = numerator / denominator;
+            uint64_t remainder = numerator % denominator;
+
+            int last_below_nine = -1;
+            uint64_t probe = remainder;
+            for (int index = 0; index < precision; index++) {
+                uint64_t scaled = probe * 10;
+                if (scaled / denominator != 9)
+                    last_below_nine = index;
+                probe = scaled % denominator;
+            }
+            bool round_up = 2 * probe >= denominator;
+            if (round_up && last_below_nine < 0)
+                whole++;
+
+            out = write_unsigned(out, whole);
+            if (precision <= 0)
+                return out;
+
+            *out++ = '.';
+            for (int index = 0; index < precision; index++) {
+                uint64_t scaled = remainder * 10;
+                uint64_t digit = scaled / denominator;
+                remainder = scaled % denominator;
+                if (round_up && index == last_below_nine)
+                    digit++;
+                else if (round_up && index > last_below_nine)
+                    digit = 0;
+                *out++ = char('0' + digit);
+            }
+            return out;
+        }
+
+        // Decimal expansion with the repetend in parentheses. The denominator
+        // is 2^a 5^b m with m coprime to 10: the expansion starts repeating
+        // after max(a, b) digits, with a period equal to the order of 10 mod m.
+        template <typename OutputIt>
+        OutputIt write_repeating(OutputIt out, uint32_t numerator, uint32_t denominator, int max_digits) {
+            out = write_unsigned(out, numerator / denominator);
+            uint64_t remainder = numerator % denominator;
+            if (remainder == 0)
+                return out;
+
+            int twos = 0;
+            int fives = 0;
+            uint32_t coprime = denominator;
+            for (; coprime % 2 == 0; coprime /= 2)
+                twos++;
+            for (; coprime % 5 == 0; coprime /= 5)
+                fives++;
+            int preperiod = max(twos, fives);
+
+            // Only count as far as we are going to print.
+            int period = 0;
+            if (coprime > 1) {
+                uint64_t power = 10 % coprime;
+                period = 1;
+                while (power != 1 && preperiod + period <= max_digits) {
+                    power = power * 10 % coprime;
+                    period++;
+                }
+            }
+
+            *out++ = '.';
+            int total = preperiod + period;
+            int shown = min(total, max_digits);
+            for (int index = 0; index < shown; index++) {
+                if (index == preperiod)
+                    *out++ = '(';
+                uint64_t scaled = remainder * 10;
+                *out++ = char('0' + scaled / denominator);
+                remainder = scaled % denominator;
+            }
+            if (total > shown) {
+                if (shown == preperiod && period > 0)
+                    *out++ = '(';
+                const char ellipsis[] = "...";
+                out = copy_chars(out, ellipsis, ellipsis + 3);
+            }
+            if (period > 0 && shown >= preperiod)
+                *out++ = ')';
+            return out;
+        }
+    }
+
+    // Writes value to out as described by spec, one char at a time, with no
+    // intermediate string. Returns the iterator past the last char written.
+    template <typename OutputIt>
+    OutputIt format_fraction(OutputIt out, const Fraction& value, const FractionFormatSpec& spec) {
+        if (spec.style == FractionFormatSpec::Style::Ratio || spec.style == FractionFormatSpec::Style::Mixed) {
+            char buffer[fraction_chars_max];
+            FractionFormat format = spec.style == FractionFormatSpec::Style::Ratio ? FractionFormat::Ratio : FractionFormat::Mixed;
+            to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), value, format);
+            return detail::copy_chars(out, buffer, result.ptr);
+        }
+
+        int numerator = value.getNumerator();
+        uint32_t magnitude = numerator < 0 ? 0U - uint32_t(numerator) : uint32_t(numerator);
+        uint32_t denominator = uint32_t(value.getDenominator());
+        if (numerator < 0)
+            *out++ = '-';
+
+        if (spec.style == FractionFormatSpec::Style::Fixed) {
+            int precision = spec.precision >= 0 ? spec.precision : FractionFormatSpec::default_fixed_precision;
+            return detail::write_fixed(out, magnitude, denominator, precision);
+        }
+        int max_digits = spec.precision >= 0 ? spec.precision : FractionFormatSpec::default_repeating_precision;
+        return detail::write_repeating(out, magnitude, denominator, max_digits);
+    }
+}
+
+#if defined(__cpp_lib_format)
+// std::format("{:m}", fraction) and friends; see FractionFormatSpec for the specs.
+//
+// Not yet built or tested: neither of the compilers this is developed with
+// (clang 14, g++ 12) has <format>. StudentTest3's "std::format" case covers
+// it once one that does is used.
+template <>
+struct std::formatter<ariel::Fraction> {
+    ariel::FractionFormatSpec spec;
+
+    constexpr auto parse(std::format_parse_context& context) {
+        auto result = ariel::parse_format_spec(context.begin(), context.end(), spec);
+        if (!result.valid)
+            throw std::format_error("Invalid format spec for Fraction");
+        return result.end;
+    }
+
+    template <typename FormatContext>
+    auto format(const ariel::Fraction& value, FormatContext& context) const {
+        return ariel::format_fraction(context.out(), value, spec);
+    }
+};
+#endif
@@ -0,0 +1,20 @@
+#include "FractionHash.hpp"
+
+namespace ariel
+{
+    void hash_fractions(const int* numerators, const int* denominators, size_t count, uint64_t* hashes, uint64_t seed) {
+        // Independent iterations, so the multiplies of neighbouring values overlap.
+        for (size_t index = 0; index < count; index++)
+            hashes[index] = hash_fraction(numerators[index], denominators[index], seed);
+    }
+
+    void hash_fractions(const FractionColumn& column, uint64_t* hashes, uint64_t seed) {
+        hash_fractions(column.getNumerators().data(), column.getDenominators().data(), column.size(), hashes, seed);
+    }
+
+    vector<uint64_t> hash_fractions(const FractionColumn& column, uint64_t seed) {
+        vector<uint64_t> hashes(column.size());
+        hash_fractions(column, hashes.data(), seed);
+        return hashes;
+    }
+}
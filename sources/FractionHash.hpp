@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Fraction.hpp"
+#include "FractionColumn.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace ariel
+{
+    // Hash of a fraction in lowest terms with a positive denominator, the
+    // form Fraction and FractionColumn always keep, so equal values always
+    // hash equally.
+    //
+    // The numerator and denominator are packed into 64 bits and run through
+    // the splitmix64 finalizer. The finalizer is a bijection in which every
+    // input bit flips each output bit with probability about 1/2, so distinct
+    // fractions never collide in the full 64 bits, and regular grids such as
+    // k/100 still spread evenly over the low bits that pick a bucket.
+    // Different seeds give independent hashes, e.g. for partitioning a hash
+    // join and then building the tables of each partition.
+    inline uint64_t hash_fraction(int numerator, int denominator, uint64_t seed = 0) {
+        uint64_t bits = (uint64_t(uint32_t(numerator)) << 32 | uint32_t(denominator)) ^ seed;
+        bits = (bits ^ (bits >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        bits = (bits ^ (bits >> 27)) * 0x94D049BB133111EBULL;
+        return bits ^ (bits >> 31);
+    }
+
+    inline uint64_t hash_fraction(const Fraction& value, uint64_t seed = 0) {
+        return hash_fraction(value.getNumerator(), value.getDenominator(), seed);
+    }
+
+    // Batch hashing for hash joins and group-bys: hashes[i] is the hash of
+    // the i-th fraction. hashes must have room for count values.
+    void hash_fractions(const int* numerators, const int* denominators, size_t count, uint64_t* hashes, uint64_t seed = 0);
+    void hash_fractions(const FractionColumn& column, uint64_t* hashes, uint64_t seed = 0);
+    vector<uint64_t> hash_fractions(const FractionColumn& column, uint64_t seed = 0);
+}
+
+// unordered_map<ariel::Fraction, ...> and friends.
+template <>
+struct std::hash<ariel::Fraction> {
+    size_t operator()(const ariel::Fraction& value) const noexcept {
+        return size_t(ariel::hash_fraction(value));
+    }
+};
@@ -0,0 +1,307 @@
+#include "FractionKey.hpp"
+
+#include <limits>
+#include <utility>
+#include <stdexcept>
+
+namespace ariel
+{
+    using wide = __int128;
+
+    // Terms after a0 below this take one byte; larger ones take a header
+    // byte small_term_limit + n followed by n bytes, big endian.
+    static const uint8_t small_term_limit = 0xF0;
+    // The infinite term that ends every key; no finite term starts with it.
+    static const uint8_t infinite_term = 0xFF;
+    // a0 is written as a header byte signed_term_zero + n for a0 >= 0 and
+    // signed_term_zero - n for a0 < 0, followed by n bytes of a0 + 256^n.
+    static const uint8_t signed_term_zero = 0x80;
+
+    static long long floor_divide(long long numerator, long long denominator) {
+        long long quotient = numerator / denominator;
+        return quotient * denominator > numerator ? quotient - 1 : quotient;
+    }
+
+    static wide floor_divide(wide numerator, wide denominator) {
+        wide quotient = numerator / denominator;
+        return quotient * denominator > numerator ? quotient - 1 : quotient;
+    }
+
+    static size_t byte_count(uint64_t value) {
+        size_t count = 0;
+        for (; value != 0; value >>= 8)
+            count++;
+        return count;
+    }
+
+    static uint8_t* write_big_endian(uint8_t* out, uint64_t value, size_t count) {
+        for (size_t index = count; index > 0; index--)
+            *out++ = uint8_t(value >> (8 * (index - 1)));
+        return out;
+    }
+
+    static uint64_t read_big_endian(const uint8_t* in, size_t count) {
+        uint64_t value = 0;
+        for (size_t index = 0; index < count; index++)
+            value = value << 8 | in[index];
+        return value;
+    }
+
+    // Variable length keys:
+
+    static uint8_t* write_signed_term(uint8_t* out, long long term) {
+        if (term >= 0) {
+            size_t count = byte_count(uint64_t(term));
+            *out++ = uint8_t(signed_term_zero + count);
+            return write_big_endian(out, uint64_t(term), count);
+        }
+        // The fewest bytes n with term >= -256^n.
+        size_t count = byte_count(uint64_t(-(term + 1)));
+        if (count == 0)
+            count = 1;
+        *out++ = uint8_t(signed_term_zero - count);
+        return write_big_endian(out, uint64_t(term) + (uint64_t(1) << (8 * count)), count);
+    }
+
+    static uint8_t* write_term(uint8_t* out, uint64_t term, bool complement) {
+        uint8_t mask = complement ? 0xFF : 0x00;
+        if (term < small_term_limit) {
+            *out++ = uint8_t(term) ^ mask;
+            return out;
+        }
+        size_t count = byte_count(term);
+        *out++ = uint8_t(small_term_limit + count) ^ mask;
+        for (size_t index = count; index > 0; index--)
+            *out++ = uint8_t(term >> (8 * (index - 1))) ^ mask;
+        return out;
+    }
+
+    uint8_t* write_fraction_key(uint8_t* out, const Fraction& value) {
+        long long numerator = value.getNumerator();
+        long long denominator = value.getDenominator();
+        long long whole = floor_divide(numerator, denominator);
+        out = write_signed_term(out, whole);
+
+        // Euclid on the fractional part gives the remaining terms.
+        long long top = denominator;
+        long long bottom = numerator - whole * denominator;
+        bool odd = true;
+        while (bottom != 0) {
+            out = write_term(out, uint64_t(top / bottom), odd);
+            long long remainder = top % bottom;
+            top = bottom;
+            bottom = remainder;
+            odd = !odd;
+        }
+        *out++ = odd ? uint8_t(~infinite_term) : infinite_term;
+        return out;
+    }
+
+    static const uint8_t* read_signed_term(const uint8_t* in, const uint8_t* end, long long& term) {
+        if (in == end)
+            return nullptr;
+        uint8_t header = *in++;
+        bool negative = header < signed_term_zero;
+        size_t count = negative ? size_t(signed_term_zero - header) : size_t(header - signed_term_zero);
+        if (count > 4 || count > size_t(end - in) || (negative && count == 0))
+            return nullptr;
+
+        uint64_t bytes = read_big_endian(in, count);
+        if (negative) {
+            term = static_cast<long long>(bytes) - (1LL << (8 * count));
+            // Not the fewest bytes: it would fit with one byte less.
+            if (count > 1 && term >= -(1LL << (8 * (count - 1))))
+                return nullptr;
+        }
+        else {
+            term = static_cast<long long>(bytes);
+            if (count > 0 && byte_count(bytes) != count)
+                return nullptr;
+        }
+        return in + count;
+    }
+
+    // Reads a term after a0; infinite is set for the terminator.
+    static const uint8_t* read_term(const uint8_t* in, const uint8_t* end, bool complement,
+                                    uint64_t& term, bool& infinite) {
+        if (in == end)
+            return nullptr;
+        uint8_t mask = complement ? 0xFF : 0x00;
+        uint8_t header = *in++ ^ mask;
+        infinite = header == infinite_term;
+        if (infinite)
+            return in;
+        if (header < small_term_limit) {
+            term = header;
+            return term == 0 ? nullptr : in;
+        }
+
+        size_t count = size_t(header - small_term_limit);
+        if (count == 0 || count > 4 || count > size_t(end - in))
+            return nullptr;
+        term = 0;
+        for (size_t index = 0; index < count; index++)
+            term = term << 8 | uint8_t(in[index] ^ mask);
+        if (term < small_term_limit || byte_count(term) != count)
+            return nullptr;
+        return in + count;
+    }
+
+    const uint8_t* read_fraction_key(const uint8_t* in, const uint8_t* end, Fraction& value) {
+        long long whole = 0;
+        in = read_signed_term(in, end, whole);
+        if (in == nullptr)
+            return nullptr;
+
+        // Convergents: numerator / denominator of [a0; a1, ... an].
+        const wide int_min = numeric_limits<int>::min();
+        const wide int_max = numeric_limits<int>::max();
+        wide numerator = whole;
+        wide denominator = 1;
+        wide previous_numerator = 1;
+        wide previous_denominator = 0;
+        uint64_t last_term = 0;
+        bool odd = true;
+        while (true) {
+            uint64_t term = 0;
+            bool infinite = false;
+            in = read_term(in, end, odd, term, infinite);
+            if (in == nullptr)
+                return nullptr;
+            if (infinite)
+                break;
+
+            wide next_numerator = wide(term) * numerator + previous_numerator;
+            wide next_denominator = wide(term) * denominator + previous_denominator;
+            if (next_numerator < int_min || next_numerator > int_max || next_denominator > int_max)
+                return nullptr;
+            previous_numerator = numerator;
+            previous_denominator = denominator;
+            numerator = next_numerator;
+            denominator = next_denominator;
+            last_term = term;
+            odd = !odd;
+        }
+
+        // The last term of a continued fraction is never 1: [..., n, 1] is [..., n + 1].
+        if (whole < int_min || whole > int_max || last_term == 1)
+            return nullptr;
+        value = Fraction(int(numerator), int(denominator));
+        return in;
+    }
+
+    // Fixed width keys:
+
+    static const unsigned __int128 sign_bit_128 = static_cast<unsigned __int128>(1) << 127;
+    static const uint64_t sign_bit_64 = uint64_t(1) << 63;
+
+    // Simplest fraction (smallest denominator) in [low, low + 1) / 2^shift,
+    // the values whose key is low. Each step takes the integer part off both
+    // ends and inverts what is left, which is the continued fraction of the
+    // interval; inverting swaps the ends, and with them which one is open.
+    static void simplest_in_interval(wide low, int shift, wide& numerator, wide& denominator) {
+        wide low_top = low;
+        wide low_bottom = wide(1) << shift;
+        wide high_top = low + 1;
+        wide high_bottom = low_bottom;
+        bool low_open = false;
+        bool high_open = true;
+
+        // result = (p * x + p_previous) / (q * x + q_previous) for the x
+        // still to be found between low_top / low_bottom and high_top / high_bottom.
+        wide p = 1;
+        wide p_previous = 0;
+        wide q = 0;
+        wide q_previous = 1;
+        while (true) {
+            wide whole = floor_divide(low_top, low_bottom);
+            wide ceiling = whole * low_bottom == low_top && !low_open ? whole : whole + 1;
+            if (high_open ? ceiling * high_bottom < high_top : ceiling * high_bottom <= high_top) {
+                numerator = p * ceiling + p_previous;
+                denominator = q * ceiling + q_previous;
+                return;
+            }
+
+            wide next_p = p * whole + p_previous;
+            wide next_q = q * whole + q_previous;
+            p_previous = p;
+            q_previous = q;
+            p = next_p;
+            q = next_q;
+
+            // x = whole + 1 / y with y between high_bottom / (high_top - whole high_bottom)
+            // and low_bottom / (low_top - whole low_bottom).
+            wide next_low_top = high_bottom;
+            wide next_low_bottom = high_top - whole * high_bottom;
+            wide next_high_top = low_bottom;
+            wide next_high_bottom = low_top - whole * low_bottom;
+            low_top = next_low_top;
+            low_bottom = next_low_bottom;
+            high_top = next_high_top;
+            high_bottom = next_high_bottom;
+            swap(low_open, high_open);
+        }
+    }
+
+    unsigned __int128 fraction_key128(const Fraction& value) {
+        wide key = floor_divide(wide(value.getNumerator()) << 62, wide(value.getDenominator()));
+        return static_cast<unsigned __int128>(key) ^ sign_bit_128;
+    }
+
+    Fraction fraction_from_key128(unsigned __int128 key) {
+        wide numerator = 0;
+        wide denominator = 1;
+        simplest_in_interval(wide(key ^ sign_bit_128), 62, numerator, denominator);
+        if (numerator < numeric_limits<int>::min() || numerator > numeric_limits<int>::max() ||
+            denominator > numeric_limits<int>::max())
+            throw overflow_error("Integer overflow! ");
+        Fraction value(static_cast<int>(numerator), static_cast<int>(denominator));
+        // Only the key the value encodes to decodes to it.
+        if (fraction_key128(value) != key)
+            throw overflow_error("Integer overflow! ");
+        return value;
+    }
+
+    unsigned __int128 fraction_key128(const Fraction64& value) {
+        wide key = floor_divide(wide(value.getNumerator()) << 64, wide(value.getDenominator()));
+        return static_cast<unsigned __int128>(key) ^ sign_bit_128;
+    }
+
+    Fraction64 fraction64_from_key128(unsigned __int128 key) {
+        wide numerator = 0;
+        wide denominator = 1;
+        simplest_in_interval(wide(key ^ sign_bit_128), 64, numerator, denominator);
+        // The constructor checks the range.
+        Fraction64 value(numerator, denominator);
+        if (fraction_key128(value) != key)
+            throw overflow_error("Integer overflow! ");
+        return value;
+    }
+
+    uint64_t fraction_key64(const Fraction32& value) {
+        long long key = floor_divide(static_cast<long long>(value.getNumerator()) * (1LL << 32), static_cast<long long>(value.getDenominator()));
+        return uint64_t(key) ^ sign_bit_64;
+    }
+
+    Fraction32 fraction32_from_key64(uint64_t key) {
+        wide numerator = 0;
+        wide denominator = 1;
+        simplest_in_interval(wide(static_cast<long long>(key ^ sign_bit_64)), 32, numerator, denominator);
+        if (numerator < numeric_limits<int16_t>::min() || numerator > numeric_limits<int16_t>::max() ||
+            denominator > numeric_limits<uint16_t>::max())
+            throw overflow_error("Integer overflow! ");
+        Fraction32 value(static_cast<long long>(numerator), static_cast<long long>(denominator));
+        if (fraction_key64(value) != key)
+            throw overflow_error("Integer overflow! ");
+        return value;
+    }
+
+    uint8_t* write_key_bytes(uint8_t* out, unsigned __int128 key) {
+        out = write_big_endian(out, uint64_t(key >> 64), 8);
+        return write_big_endian(out, uint64_t(key), 8);
+    }
+
+    uint8_t* write_key_bytes(uint8_t* out, uint64_t key) {
+        return write_big_endian(out, key, 8);
+    }
+}
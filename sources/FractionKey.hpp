@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Fraction.hpp"
+#include "PackedFraction.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ariel
+{
+    // Keys that sort in the same order as the fractions they come from, so
+    // that sorting and searching can compare bytes or integers instead of
+    // cross multiplying.
+
+    // Variable length byte keys, compared with memcmp (a key that is a prefix
+    // of another sorts first, though no key is a prefix of another).
+    //
+    // A key is the continued fraction [a0; a1, a2, ...] of the value, with
+    // a0 = floor(value): a0 as a signed term, then every further term, then
+    // a terminator that stands for an infinite term. A larger term at an even
+    // position makes a larger value and at an odd position a smaller one, so
+    // the terms and the terminator at odd positions are complemented. Simple
+    // values get short keys: 1/2 takes 3 bytes, 355/113 five.
+    //
+    // No key is longer than fraction_key_max bytes.
+    constexpr size_t fraction_key_max = 52;
+
+    // Writes the key of value at out, which must have room for
+    // fraction_key_max bytes. Returns the position past the last byte written.
+    uint8_t* write_fraction_key(uint8_t* out, const Fraction& value);
+
+    // Reads a key from [in, end). Returns the position past it, or nullptr if
+    // the input ends first or is not a key written by write_fraction_key.
+    const uint8_t* read_fraction_key(const uint8_t* in, const uint8_t* end, Fraction& value);
+
+    // Fixed width keys: floor(value * 2^s) with the sign bit flipped, so the
+    // keys compare as unsigned integers. s is chosen so that two different
+    // fractions of the type are more than 2^-s apart, which makes the key
+    // one-to-one; decoding finds the simplest fraction in [key, key + 1) / 2^s.
+    //     Fraction      s = 62, 128 bit key
+    //     Fraction64    s = 64, 128 bit key
+    //     Fraction32    s = 32, 64 bit key
+    // Decoding a key that no value of the type maps to throws overflow_error.
+    unsigned __int128 fraction_key128(const Fraction& value);
+    Fraction fraction_from_key128(unsigned __int128 key);
+
+    unsigned __int128 fraction_key128(const Fraction64& value);
+    Fraction64 fraction64_from_key128(unsigned __int128 key);
+
+    uint64_t fraction_key64(const Fraction32& value);
+    Fraction32 fraction32_from_key64(uint64_t key);
+
+    // Stores a fixed width key big endian, so that memcmp on the bytes agrees
+    // with comparing the keys. Returns the position past the last byte written.
+    uint8_t* write_key_bytes(uint8_t* out, unsigned __int128 key);
+    uint8_t* write_key_bytes(uint8_t* out, uint64_t key);
+}
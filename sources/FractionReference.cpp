@@ -0,0 +1,101 @@
+#include "FractionReference.hpp"
+
+#include <cstdlib>
+#include <limits>
+
+namespace ariel
+{
+    using wide = __int128;
+
+    static bool fits_int(wide value) {
+        return value >= numeric_limits<int>::min() && value <= numeric_limits<int>::max();
+    }
+
+    static wide wide_abs(wide value) {
+        return value < 0 ? -value : value;
+    }
+
+    static ReferenceResult reduce_wide(wide numerator, wide denominator) {
+        wide lhs = wide_abs(numerator);
+        wide rhs = wide_abs(denominator);
+        while (rhs != 0) {
+            wide remainder = lhs % rhs;
+            lhs = rhs;
+            rhs = remainder;
+        }
+        numerator /= lhs;
+        denominator /= lhs;
+        if (denominator < 0) {
+            numerator = -numerator;
+            denominator = -denominator;
+        }
+
+        if (!fits_int(numerator) || !fits_int(denominator))
+            return {true, 0, 1};
+        return {false, static_cast<int>(numerator), static_cast<int>(denominator)};
+    }
+
+    bool fraction_validation_enabled() {
+#if defined(FRACTION_VALIDATE)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    ReferenceResult reference_fraction(long long numerator, long long denominator) {
+        return reduce_wide(numerator, denominator);
+    }
+
+    ReferenceResult reference_arithmetic(char operation, const Fraction& lhs, const Fraction& rhs) {
+        wide a = lhs.getNumerator(), b = lhs.getDenominator();
+        wide c = rhs.getNumerator(), d = rhs.getDenominator();
+
+        wide numerator = 0, denominator = 1;
+        switch (operation) {
+            case '+':
+            case '-': {
+                wide ad = a * d, cb = c * b, bd = b * d;
+                if (!fits_int(ad) || !fits_int(cb) || !fits_int(bd))
+                    return {true, 0, 1};
+                numerator = operation == '+' ? ad + cb : ad - cb;
+                denominator = bd;
+                break;
+            }
+            case '*':
+                numerator = a * c;
+                denominator = b * d;
+                break;
+            case '/':
+                numerator = a * d;
+                denominator = b * c;
+                break;
+            default:
+                throw invalid_argument(string("Unknown operation ") + operation);
+        }
+
+        if (!fits_int(numerator) || !fits_int(denominator))
+            return {true, 0, 1};
+        return reduce_wide(numerator, denominator);
+    }
+
+    int reference_compare(const Fraction& lhs, const Fraction& rhs) {
+        wide left = static_cast<wide>(lhs.getNumerator()) * rhs.getDenominator();
+        wide right = static_cast<wide>(rhs.getNumerator()) * lhs.getDenominator();
+        return left < right ? -1 : left > right ? 1 : 0;
+    }
+
+    string describe_reference(const ReferenceResult& result) {
+        if (result.overflow)
+            return "overflow_error";
+        return to_string(result.numerator) + "/" + to_string(result.denominator);
+    }
+
+    void fraction_validation_failure(const string& operation, const Fraction& lhs, const Fraction& rhs,
+                                     const string& expected, const string& actual) {
+        cerr << "Fraction validation failed: " << lhs.getNumerator() << "/" << lhs.getDenominator() << " " << operation
+             << " " << rhs.getNumerator() << "/" << rhs.getDenominator() << ": expected " << expected << ", got "
+             << actual << endl;
+        abort();
+    }
+}
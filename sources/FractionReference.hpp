@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Fraction.hpp"
+
+#include <string>
+
+namespace ariel
+{
+    // Fraction's arithmetic done the slow way, in __int128, as the exact
+    // specification the optimized operators are checked against.
+    //
+    // + and - compute a/b + c/d as (a*d + c*b) / (b*d); * and / multiply
+    // the components straight across. Each of those products, and the sum
+    // or difference, must fit in an int, or the operation throws
+    // overflow_error. The result is then reduced with the sign in the
+    // numerator, and must fit as well.
+    //
+    // A library built with -DFRACTION_VALIDATE (make fraction_validate)
+    // checks every arithmetic and comparison operator against these, and
+    // aborts with the operands on the first mismatch.
+
+    // Whether the library was built with FRACTION_VALIDATE.
+    bool fraction_validation_enabled();
+
+    struct ReferenceResult {
+        bool overflow;          // the operation throws overflow_error
+        int numerator;          // otherwise the reduced result
+        int denominator;
+    };
+
+    // operation is one of + - * /. Division by zero is the caller's to
+    // rule out.
+    ReferenceResult reference_arithmetic(char operation, const Fraction& lhs, const Fraction& rhs);
+    // Fraction(numerator, denominator); denominator must not be zero.
+    ReferenceResult reference_fraction(long long numerator, long long denominator);
+    // -1, 0 or 1 as lhs is less than, equal to or greater than rhs.
+    int reference_compare(const Fraction& lhs, const Fraction& rhs);
+
+    // For the implementation: prints both operands, the expected and the
+    // actual outcome to stderr, and aborts.
+    [[noreturn]] void fraction_validation_failure(const string& operation, const Fraction& lhs, const Fraction& rhs,
+                                                  const string& expected, const string& actual);
+    string describe_reference(const ReferenceResult& result);
+}
@@ -0,0 +1,275 @@
+#include "FractionSort.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace ariel
+{
+    // Runs of equal keys longer than this are sorted with stable_sort, shorter
+    // ones with insertion sort.
+    static const size_t insertion_sort_limit = 32;
+
+    // What the sorts move around: the key and what it was made from. Not
+    // Fraction itself, which reduces again on every copy.
+    struct SortPair {
+        uint64_t key;
+        int numerator;
+        int denominator;
+    };
+    struct SortIndex {
+        uint64_t key;
+        size_t index;
+    };
+
+    // floor(numerator * 2^30 / denominator), with the sign bit flipped so
+    // that the keys compare as unsigned integers.
+    static uint64_t sort_key(int numerator, int denominator) {
+        long long scaled = static_cast<long long>(numerator) * (1LL << 30);
+        long long quotient = scaled / denominator;
+        if (quotient * denominator > scaled)
+            quotient--;
+        return uint64_t(quotient) ^ (uint64_t(1) << 63);
+    }
+
+    static bool exact_less(int lhs_numerator, int lhs_denominator, int rhs_numerator, int rhs_denominator) {
+        return static_cast<long long>(lhs_numerator) * rhs_denominator < static_cast<long long>(rhs_numerator) * lhs_denominator;
+    }
+
+    static bool entry_less(const SortPair& lhs, const SortPair& rhs) {
+        return exact_less(lhs.numerator, lhs.denominator, rhs.numerator, rhs.denominator);
+    }
+
+    static SortPair make_entry(const Fraction& value) {
+        return {sort_key(value.getNumerator(), value.getDenominator()), value.getNumerator(), value.getDenominator()};
+    }
+
+    // Orders the entries of a run with equal keys; tie_less compares two
+    // entries exactly. Stable.
+    template <typename Entry, typename Less>
+    static void sort_run(Entry* first, Entry* last, Less tie_less) {
+        if (size_t(last - first) > insertion_sort_limit) {
+            stable_sort(first, last, tie_less);
+            return;
+        }
+        for (Entry* current = first + 1; current < last; current++) {
+            Entry entry = *current;
+            Entry* hole = current;
+            for (; hole > first && tie_less(entry, hole[-1]); hole--)
+                *hole = hole[-1];
+            *hole = entry;
+        }
+    }
+
+    // LSD radix sort of entries by key, a byte per pass, then exact ordering
+    // within runs of equal keys. scratch must hold count entries.
+    template <typename Entry, typename Less>
+    static void radix_sort_entries(Entry* entries, Entry* scratch, size_t count, Less tie_less) {
+        if (count < 2)
+            return;
+
+        // All eight histograms in one pass over the keys.
+        static const unsigned digits = 8;
+        vector<size_t> counts(digits * 256);
+        for (size_t index = 0; index < count; index++) {
+            uint64_t key = entries[index].key;
+            for (unsigned digit = 0; digit < digits; digit++)
+                counts[digit * 256 + ((key >> (8 * digit)) & 0xFF)]++;
+        }
+
+        Entry* from = entries;
+        Entry* to = scratch;
+        for (unsigned digit = 0; digit < digits; digit++) {
+            size_t* bucket = &counts[digit * 256];
+            // A byte that is the same in every key doesn't change the order.
+            if (bucket[(from[0].key >> (8 * digit)) & 0xFF] == count)
+                continue;
+
+            size_t offset = 0;
+            for (unsigned byte = 0; byte < 256; byte++) {
+                size_t size = bucket[byte];
+                bucket[byte] = offset;
+                offset += size;
+            }
+            for (size_t index = 0; index < count; index++)
+                to[bucket[(from[index].key >> (8 * digit)) & 0xFF]++] = from[index];
+            swap(from, to);
+        }
+        if (from != entries)
+            copy(from, from + count, entries);
+
+        for (size_t start = 0; start < count;) {
+            size_t end = start + 1;
+            while (end < count && entries[end].key == entries[start].key)
+                end++;
+            if (end - start > 1)
+                sort_run(entries + start, entries + end, tie_less);
+            start = end;
+        }
+    }
+
+    template <typename Entry>
+    static void radix_sort_entries(Entry* entries, Entry* scratch, size_t count) {
+        radix_sort_entries(entries, scratch, count, [](const Entry& lhs, const Entry& rhs) {
+            return entry_less(lhs, rhs);
+        });
+    }
+
+    static unsigned thread_count(unsigned threads, size_t count) {
+        // Below this many values per thread, a thread costs more than it saves.
+        const size_t min_slice = 1 << 16;
+        size_t wanted = threads != 0 ? threads : max(1U, thread::hardware_concurrency());
+        return unsigned(max(size_t(1), min(wanted, count / min_slice)));
+    }
+
+    // Runs body(slice, first, last) for each of slices equal parts of [0, count), each on its own thread.
+    template <typename Body>
+    static void for_each_slice(unsigned slices, size_t count, Body body) {
+        vector<thread> workers;
+        for (unsigned slice = 0; slice < slices; slice++)
+            workers.emplace_back(body, slice, count * slice / slices, count * (slice + 1) / slices);
+        for (thread& worker : workers)
+            worker.join();
+    }
+
+    // Sorts entries with threads: slices are radix sorted, then merged in
+    // rounds, the merges of a round on separate threads. Returns the sorted
+    // entries, which are either entries or scratch.
+    template <typename Entry>
+    static Entry* parallel_sort_entries(Entry* entries, Entry* scratch, size_t count, unsigned slices) {
+        auto key_less = [](const Entry& lhs, const Entry& rhs) {
+            return lhs.key < rhs.key || (lhs.key == rhs.key && entry_less(lhs, rhs));
+        };
+
+        for_each_slice(slices, count, [&](unsigned, size_t first, size_t last) {
+            radix_sort_entries(entries + first, scratch + first, last - first);
+        });
+
+        // bounds[i] .. bounds[i + 1] is a sorted run.
+        vector<size_t> bounds;
+        for (unsigned slice = 0; slice <= slices; slice++)
+            bounds.push_back(count * slice / slices);
+
+        Entry* from = entries;
+        Entry* to = scratch;
+        while (bounds.size() > 2) {
+            size_t runs = bounds.size() - 1;
+            vector<thread> workers;
+            vector<size_t> merged;
+            for (size_t run = 0; run < runs; run += 2) {
+                merged.push_back(bounds[run]);
+                size_t first = bounds[run];
+                size_t middle = bounds[run + 1];
+                size_t last = run + 2 <= runs ? bounds[run + 2] : middle;
+                workers.emplace_back([=]() {
+                    merge(from + first, from + middle, from + middle, from + last, to + first, key_less);
+                });
+            }
+            merged.push_back(count);
+            for (thread& worker : workers)
+                worker.join();
+            bounds = merged;
+            swap(from, to);
+        }
+        return from;
+    }
+
+    // Radix sort:
+
+    void radix_sort(Fraction* first, Fraction* last) {
+        size_t count = size_t(last - first);
+        vector<SortPair> entries(count);
+        vector<SortPair> scratch(count);
+        transform(first, last, entries.begin(), make_entry);
+        radix_sort_entries(entries.data(), scratch.data(), count);
+        for (size_t index = 0; index < count; index++)
+            first[index] = Fraction(entries[index].numerator, entries[index].denominator);
+    }
+
+    void radix_sort(vector<Fraction>& values) {
+        radix_sort(values.data(), values.data() + values.size());
+    }
+
+    // Builds the entries of a column, sorts them with sort, and stores them back.
+    template <typename Sort>
+    static void sort_column(FractionColumn& column, Sort sort) {
+        size_t count = column.size();
+        const vector<int>& numerators = column.getNumerators();
+        const vector<int>& denominators = column.getDenominators();
+        vector<SortPair> entries(count);
+        vector<SortPair> scratch(count);
+        for (size_t index = 0; index < count; index++)
+            entries[index] = {sort_key(numerators[index], denominators[index]), numerators[index], denominators[index]};
+
+        const SortPair* sorted = sort(entries.data(), scratch.data(), count);
+
+        vector<int> sorted_numerators(count);
+        vector<int> sorted_denominators(count);
+        for (size_t index = 0; index < count; index++) {
+            sorted_numerators[index] = sorted[index].numerator;
+            sorted_denominators[index] = sorted[index].denominator;
+        }
+        column.clear();
+        column.append_reduced(sorted_numerators.data(), sorted_denominators.data(), count);
+    }
+
+    void radix_sort(FractionColumn& column) {
+        sort_column(column, [](SortPair* entries, SortPair* scratch, size_t count) {
+            radix_sort_entries(entries, scratch, count);
+            return entries;
+        });
+    }
+
+    // Parallel sort:
+
+    void parallel_sort(Fraction* first, Fraction* last, unsigned threads) {
+        size_t count = size_t(last - first);
+        unsigned slices = thread_count(threads, count);
+        if (slices == 1) {
+            radix_sort(first, last);
+            return;
+        }
+
+        vector<SortPair> entries(count);
+        vector<SortPair> scratch(count);
+        for_each_slice(slices, count, [&](unsigned, size_t begin, size_t end) {
+            transform(first + begin, first + end, entries.begin() + ptrdiff_t(begin), make_entry);
+        });
+        const SortPair* sorted = parallel_sort_entries(entries.data(), scratch.data(), count, slices);
+        for_each_slice(slices, count, [&](unsigned, size_t begin, size_t end) {
+            for (size_t index = begin; index < end; index++)
+                first[index] = Fraction(sorted[index].numerator, sorted[index].denominator);
+        });
+    }
+
+    void parallel_sort(vector<Fraction>& values, unsigned threads) {
+        parallel_sort(values.data(), values.data() + values.size(), threads);
+    }
+
+    void parallel_sort(FractionColumn& column, unsigned threads) {
+        unsigned slices = thread_count(threads, column.size());
+        sort_column(column, [slices](SortPair* entries, SortPair* scratch, size_t count) {
+            return parallel_sort_entries(entries, scratch, count, slices);
+        });
+    }
+
+    // Sorted order:
+
+    vector<size_t> sorted_order(const FractionColumn& column) {
+        size_t count = column.size();
+        const vector<int>& numerators = column.getNumerators();
+        const vector<int>& denominators = column.getDenominators();
+        vector<SortIndex> entries(count);
+        vector<SortIndex> scratch(count);
+        for (size_t index = 0; index < count; index++)
+            entries[index] = {sort_key(numerators[index], denominators[index]), index};
+
+        radix_sort_entries(entries.data(), scratch.data(), count, [&](const SortIndex& lhs, const SortIndex& rhs) {
+            return exact_less(numerators[lhs.index], denominators[lhs.index], numerators[rhs.index], denominators[rhs.index]);
+        });
+
+        vector<size_t> order(count);
+        for (size_t index = 0; index < count; index++)
+            order[index] = entries[index].index;
+        return order;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Fraction.hpp"
+#include "FractionColumn.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ariel
+{
+    // Sorting by value without calling operator<.
+    //
+    // Each value gets a 64 bit key, floor(value * 2^30) with the sign bit
+    // flipped, a coarser fraction_key128. An LSD radix sort orders the
+    // keys a byte at a time, skipping the bytes that are the same for every
+    // key, and the rare runs of different values with the same key (closer
+    // than 2^-30) are ordered by exact cross multiplication. Unlike
+    // operator<, the result is right for any values, not only those whose
+    // cross products fit in an int.
+    //
+    // The sorts are stable and take O(n) extra memory. Fraction reduces on
+    // every copy, so storing the sorted values back into a Fraction array
+    // still costs a gcd per value; the FractionColumn overloads don't.
+    void radix_sort(Fraction* first, Fraction* last);
+    void radix_sort(vector<Fraction>& values);
+    void radix_sort(FractionColumn& column);
+
+    // Same result, using threads: each thread radix sorts a slice, and the
+    // slices are merged pairwise, the merges of a round in parallel.
+    // threads = 0 uses thread::hardware_concurrency().
+    void parallel_sort(Fraction* first, Fraction* last, unsigned threads = 0);
+    void parallel_sort(vector<Fraction>& values, unsigned threads = 0);
+    void parallel_sort(FractionColumn& column, unsigned threads = 0);
+
+    // The permutation that sorts column, with equal values in their original
+    // order: column[order[0]] <= column[order[1]] <= ... For sorting other
+    // data along with the fractions.
+    vector<size_t> sorted_order(const FractionColumn& column);
+}
@@ -0,0 +1,106 @@
+#include "FractionStats.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // Adds sign * from into into, reading from with atomic loads.
+    static void accumulate_stats(FractionStats& into, FractionStats& from, int sign) {
+        auto add = [sign](uint64_t& total, uint64_t& counter) {
+            uint64_t value = atomic_ref<uint64_t>(counter).load(memory_order_relaxed);
+            total = sign > 0 ? total + value : total - value;
+        };
+        add(into.constructions, from.constructions);
+        add(into.reductions, from.reductions);
+        add(into.already_reduced, from.already_reduced);
+        add(into.fast_paths, from.fast_paths);
+        add(into.slow_paths, from.slow_paths);
+        add(into.overflow_errors, from.overflow_errors);
+        add(into.invalid_arguments, from.invalid_arguments);
+        add(into.runtime_errors, from.runtime_errors);
+        add(into.filtered_comparisons, from.filtered_comparisons);
+        add(into.exact_comparisons, from.exact_comparisons);
+        for (size_t bucket = 0; bucket < fraction_gcd_histogram_size; bucket++)
+            add(into.gcd_iterations[bucket], from.gcd_iterations[bucket]);
+    }
+
+    // The counters of every live thread, and the sums of exited threads.
+    // Reset doesn't write other threads' counters; it remembers the totals
+    // as a baseline to subtract.
+    struct StatsRegistry {
+        mutex lock;
+        vector<FractionStats*> threads;
+        FractionStats exited;
+        FractionStats baseline;
+
+        FractionStats total() {
+            FractionStats sum = exited;
+            for (FractionStats* stats : threads)
+                accumulate_stats(sum, *stats, 1);
+            return sum;
+        }
+    };
+
+    static StatsRegistry& stats_registry() {
+        static StatsRegistry registry;
+        return registry;
+    }
+
+    struct ThreadStats {
+        FractionStats stats;
+
+        ThreadStats() {
+            StatsRegistry& registry = stats_registry();
+            lock_guard<mutex> guard(registry.lock);
+            registry.threads.push_back(&stats);
+        }
+        ThreadStats(const ThreadStats& other) = delete;
+        ThreadStats& operator=(const ThreadStats& other) = delete;
+        ~ThreadStats() {
+            StatsRegistry& registry = stats_registry();
+            lock_guard<mutex> guard(registry.lock);
+            accumulate_stats(registry.exited, stats, 1);
+            registry.threads.erase(find(registry.threads.begin(), registry.threads.end(), &stats));
+        }
+    };
+
+    uint64_t FractionStats::exceptions() const {
+        return overflow_errors + invalid_arguments + runtime_errors;
+    }
+
+    double FractionStats::exactComparisonRate() const {
+        uint64_t comparisons = filtered_comparisons + exact_comparisons;
+        return comparisons == 0 ? 0 : double(exact_comparisons) / double(comparisons);
+    }
+
+    bool fraction_stats_enabled() {
+#if defined(FRACTION_STATS)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    FractionStats fraction_stats_snapshot() {
+        StatsRegistry& registry = stats_registry();
+        lock_guard<mutex> guard(registry.lock);
+        FractionStats snapshot = registry.total();
+        accumulate_stats(snapshot, registry.baseline, -1);
+        return snapshot;
+    }
+
+    void fraction_stats_reset() {
+        StatsRegistry& registry = stats_registry();
+        lock_guard<mutex> guard(registry.lock);
+        registry.baseline = registry.total();
+    }
+
+    FractionStats& local_fraction_stats() {
+        thread_local ThreadStats local;
+        return local.stats;
+    }
+}
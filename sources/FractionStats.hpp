@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ariel
+{
+    // Counts of what the Fraction implementation did, for finding out why a
+    // job is slow: many reductions, long gcd chains or exceptions.
+    //
+    // Counted only when the library is built with -DFRACTION_STATS (make
+    // test3_stats does); otherwise the hooks compile to nothing and every
+    // snapshot is zero. The hooks in headers (PackedFraction's) count only
+    // in translation units built with it too. Each thread counts into its
+    // own counters, so counting needs no atomic read-modify-write; a
+    // snapshot adds up all threads, including those that have exited.
+
+    // gcd_iterations[i] counts the reductions whose Euclid loop took i steps;
+    // the last bucket also takes all longer ones. No two ints need more than
+    // 46 steps.
+    constexpr size_t fraction_gcd_histogram_size = 48;
+
+    struct FractionStats {
+        uint64_t constructions = 0;         // every Fraction constructor
+        uint64_t reductions = 0;            // calls of reduce()
+        uint64_t already_reduced = 0;       // reductions whose gcd was 1
+        uint64_t fast_paths = 0;            // overflow checks skipped for a zero operand
+        uint64_t slow_paths = 0;            // overflow checks done
+        uint64_t overflow_errors = 0;       // exceptions thrown, by type
+        uint64_t invalid_arguments = 0;
+        uint64_t runtime_errors = 0;
+        uint64_t filtered_comparisons = 0;  // PackedFraction::filteredLess calls decided in double
+        uint64_t exact_comparisons = 0;     // and those that fell back to the exact cross products
+        uint64_t gcd_iterations[fraction_gcd_histogram_size] = {};
+
+        uint64_t exceptions() const;
+        // The share of filteredLess calls that fell back to the exact cross
+        // products; 0 when there were none.
+        double exactComparisonRate() const;
+    };
+
+    // Whether the library was built with FRACTION_STATS.
+    bool fraction_stats_enabled();
+
+    // Counts since the start or the last reset, summed over all threads.
+    // Counts of threads running concurrently are as of some point during the
+    // call.
+    FractionStats fraction_stats_snapshot();
+    void fraction_stats_reset();
+
+    // For the implementation:
+
+    // The calling thread's counters.
+    FractionStats& local_fraction_stats();
+
+    // Only the owning thread writes its counters; snapshots read them
+    // concurrently, so the writes are atomic stores.
+    inline void fraction_stats_add(uint64_t& counter, uint64_t amount = 1) {
+        std::atomic_ref<uint64_t>(counter).store(counter + amount, std::memory_order_relaxed);
+    }
+}
+
+#if defined(FRACTION_STATS)
+#define FRACTION_STAT(field) ariel::fraction_stats_add(ariel::local_fraction_stats().field)
+#else
+#define FRACTION_STAT(field) ((void)0)
+#endif
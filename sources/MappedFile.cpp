@@ -0,0 +1,82 @@
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ariel
+{
+    // Constructors:
+
+    MappedFile::MappedFile(const string& path): address(nullptr), length(0) {
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            throw runtime_error("Can't open " + path);
+
+        struct stat status {};
+        if (fstat(descriptor, &status) != 0) {
+            close(descriptor);
+            throw runtime_error("Can't stat " + path);
+        }
+
+        length = size_t(status.st_size);
+        if (length > 0) {
+            void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (mapping == MAP_FAILED) {
+                close(descriptor);
+                throw runtime_error("Can't map " + path);
+            }
+            madvise(mapping, length, MADV_SEQUENTIAL);
+            address = static_cast<const char*>(mapping);
+        }
+        // The mapping stays valid after the descriptor is closed.
+        close(descriptor);
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept: address(other.address), length(other.length) {
+        other.address = nullptr;
+        other.length = 0;
+    }
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            if (address != nullptr)
+                munmap(const_cast<char*>(address), length);
+            address = other.address;
+            length = other.length;
+            other.address = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile() {
+        if (address != nullptr)
+            munmap(const_cast<char*>(address), length);
+    }
+
+    // Get functions:
+
+    const char* MappedFile::data() const {
+        return address;
+    }
+    size_t MappedFile::size() const {
+        return length;
+    }
+    string_view MappedFile::view() const {
+        return string_view(address, length);
+    }
+
+    void MappedFile::willNeed(size_t offset, size_t size) const {
+        if (address == nullptr || offset >= length)
+            return;
+        // madvise wants a page aligned start.
+        size_t page = size_t(sysconf(_SC_PAGESIZE));
+        size_t start = offset / page * page;
+        size_t end = min(length, offset + size);
+        madvise(const_cast<char*>(address) + start, end - start, MADV_WILLNEED);
+    }
+}
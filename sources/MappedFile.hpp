@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace ariel
+{
+    // A read-only memory mapping of a whole file. Throws runtime_error if the
+    // file can't be opened or mapped. An empty file maps to an empty view.
+    class MappedFile {
+        private:
+            const char* address;
+            size_t length;
+
+        public:
+            // Constructors:
+            explicit MappedFile(const string& path);
+            MappedFile(const MappedFile& other) = delete;
+            MappedFile& operator=(const MappedFile& other) = delete;
+            MappedFile(MappedFile&& other) noexcept;
+            MappedFile& operator=(MappedFile&& other) noexcept;
+            ~MappedFile();
+
+            const char* data() const;
+            size_t size() const;
+            string_view view() const;
+
+            // Asks the kernel to start reading [offset, offset + size) in the
+            // background, so a later access doesn't wait for the disk.
+            void willNeed(size_t offset, size_t size) const;
+    };
+}
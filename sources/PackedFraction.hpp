@@ -0,0 +1,280 @@
+#pragma once
+
+#include "Fraction.hpp"
+#include "FractionStats.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ariel
+{
+    // A reduced fraction stored in a signed numerator and an unsigned
+    // denominator of the same width, for tables where the 8 bytes of Fraction
+    // are too many. Always kept in lowest terms with a positive denominator,
+    // so equal values have equal bits.
+    //
+    // Operations are done in a wider integer and narrowed back with a check;
+    // a result that does not fit throws overflow_error, just like Fraction.
+    template <typename Num, typename Den>
+    class PackedFraction {
+        static_assert(is_integral_v<Num> && is_signed_v<Num>, "numerator must be a signed integer");
+        static_assert(is_integral_v<Den> && is_unsigned_v<Den>, "denominator must be an unsigned integer");
+        static_assert(sizeof(Num) == sizeof(Den), "numerator and denominator must have the same width");
+
+        public:
+            // Wide enough for any cross product of two values, and for their
+            // sum when the components are at most 32 bit.
+            using wide = conditional_t<sizeof(Num) <= 2, long long, __int128>;
+            // Wide enough for a cross product alone, which is all a
+            // comparison needs.
+            using product = conditional_t<sizeof(Num) <= 4, long long, __int128>;
+
+        private:
+            static constexpr int float_scale = 1000;
+
+            Num numerator;
+            Den denominator;
+
+            static wide abs(wide value) {
+                return value < 0 ? -value : value;
+            }
+
+            static wide gcd(wide lhs, wide rhs) {
+                lhs = abs(lhs);
+                rhs = abs(rhs);
+                // __int128 division is a libcall per step; Euclid only
+                // shrinks the operands, so it switches to 64 bits as soon as
+                // both fit. For 32 bit components they fit from the start.
+                if constexpr (sizeof(wide) > sizeof(uint64_t)) {
+                    const wide narrow_max = numeric_limits<uint64_t>::max();
+                    while (rhs != 0 && (lhs > narrow_max || rhs > narrow_max)) {
+                        wide remainder = lhs % rhs;
+                        lhs = rhs;
+                        rhs = remainder;
+                    }
+                }
+                uint64_t narrow_lhs = static_cast<uint64_t>(lhs);
+                uint64_t narrow_rhs = static_cast<uint64_t>(rhs);
+                while (narrow_rhs != 0) {
+                    uint64_t remainder = narrow_lhs % narrow_rhs;
+                    narrow_lhs = narrow_rhs;
+                    narrow_rhs = remainder;
+                }
+                return static_cast<wide>(narrow_lhs);
+            }
+
+            // Reduces and narrows a wide result. den must not be zero.
+            void assign(wide num, wide den) {
+                if (den < 0) {
+                    num = -num;
+                    den = -den;
+                }
+
+                wide divisor = gcd(num, den);
+                if (divisor != 1) {
+                    num /= divisor;
+                    den /= divisor;
+                }
+
+                if (num < static_cast<wide>(numeric_limits<Num>::min()) ||
+                    num > static_cast<wide>(numeric_limits<Num>::max()) ||
+                    den > static_cast<wide>(numeric_limits<Den>::max()))
+                    throw overflow_error("Integer overflow! ");
+
+                numerator = static_cast<Num>(num);
+                denominator = static_cast<Den>(den);
+            }
+
+            static PackedFraction from_wide(wide num, wide den) {
+                PackedFraction result;
+                result.assign(num, den);
+                return result;
+            }
+
+            static wide checked_multiply(wide lhs, wide rhs) {
+                wide result = 0;
+                if (__builtin_mul_overflow(lhs, rhs, &result))
+                    throw overflow_error("Integer overflow! ");
+                return result;
+            }
+
+            static wide checked_add(wide lhs, wide rhs) {
+                wide result = 0;
+                if (__builtin_add_overflow(lhs, rhs, &result))
+                    throw overflow_error("Integer overflow! ");
+                return result;
+            }
+
+        public:
+            // Constructors:
+            PackedFraction(): numerator(0), denominator(1) {}
+            PackedFraction(wide numerator_in, wide denominator_in): numerator(0), denominator(1) {
+                if (denominator_in == 0)
+                    throw invalid_argument("Denominator can't be zero!");
+
+                assign(numerator_in, denominator_in);
+            }
+            PackedFraction(float other): numerator(0), denominator(1) {
+                assign(static_cast<int>(other * float_scale), float_scale);
+            }
+
+            // Checked conversions from and to Fraction; throw overflow_error
+            // when the value does not fit the target.
+            explicit PackedFraction(const Fraction& other): numerator(0), denominator(1) {
+                assign(other.getNumerator(), other.getDenominator());
+            }
+            explicit operator Fraction() const {
+                if (static_cast<wide>(numerator) < numeric_limits<int>::min() ||
+                    static_cast<wide>(numerator) > numeric_limits<int>::max() ||
+                    static_cast<wide>(denominator) > numeric_limits<int>::max())
+                    throw overflow_error("Integer overflow! ");
+
+                return Fraction(static_cast<int>(numerator), static_cast<int>(denominator));
+            }
+
+            // Get functions:
+            Num getNumerator() const {
+                return numerator;
+            }
+            Den getDenominator() const {
+                return denominator;
+            }
+
+            // Arithmetic operators:
+            PackedFraction operator-() const {
+                return from_wide(-static_cast<wide>(numerator), denominator);
+            }
+
+            friend PackedFraction operator+(const PackedFraction& lhs, const PackedFraction& rhs) {
+                return from_wide(checked_add(checked_multiply(lhs.numerator, rhs.denominator),
+                                             checked_multiply(rhs.numerator, lhs.denominator)),
+                                 checked_multiply(lhs.denominator, rhs.denominator));
+            }
+            friend PackedFraction operator-(const PackedFraction& lhs, const PackedFraction& rhs) {
+                return from_wide(checked_add(checked_multiply(lhs.numerator, rhs.denominator),
+                                             -checked_multiply(rhs.numerator, lhs.denominator)),
+                                 checked_multiply(lhs.denominator, rhs.denominator));
+            }
+            friend PackedFraction operator*(const PackedFraction& lhs, const PackedFraction& rhs) {
+                return from_wide(checked_multiply(lhs.numerator, rhs.numerator),
+                                 checked_multiply(lhs.denominator, rhs.denominator));
+            }
+            friend PackedFraction operator/(const PackedFraction& lhs, const PackedFraction& rhs) {
+                if (rhs.numerator == 0)
+                    throw runtime_error("Can't divide by zero!");
+
+                return from_wide(checked_multiply(lhs.numerator, rhs.denominator),
+                                 checked_multiply(lhs.denominator, rhs.numerator));
+            }
+
+            PackedFraction& operator+=(const PackedFraction& other) {
+                return *this = *this + other;
+            }
+            PackedFraction& operator-=(const PackedFraction& other) {
+                return *this = *this - other;
+            }
+            PackedFraction& operator*=(const PackedFraction& other) {
+                return *this = *this * other;
+            }
+            PackedFraction& operator/=(const PackedFraction& other) {
+                return *this = *this / other;
+            }
+
+            // Comparison operators:
+            friend bool operator==(const PackedFraction& lhs, const PackedFraction& rhs) {
+                return lhs.numerator == rhs.numerator && lhs.denominator == rhs.denominator;
+            }
+            friend bool operator!=(const PackedFraction& lhs, const PackedFraction& rhs) {
+                return !(lhs == rhs);
+            }
+            friend bool operator<(const PackedFraction& lhs, const PackedFraction& rhs) {
+#if defined(FRACTION_FILTERED_COMPARISONS)
+                if constexpr (sizeof(Num) >= 8)
+                    return filteredLess(lhs, rhs);
+#endif
+                return exactLess(lhs, rhs);
+            }
+            friend bool operator>(const PackedFraction& lhs, const PackedFraction& rhs) {
+                return rhs < lhs;
+            }
+            friend bool operator<=(const PackedFraction& lhs, const PackedFraction& rhs) {
+                return !(rhs < lhs);
+            }
+            friend bool operator>=(const PackedFraction& lhs, const PackedFraction& rhs) {
+                return !(lhs < rhs);
+            }
+
+            // Prefix increment and decrement operators:
+            PackedFraction& operator++() {
+                assign(checked_add(numerator, denominator), denominator);
+                return *this;
+            }
+            PackedFraction& operator--() {
+                assign(checked_add(numerator, -static_cast<wide>(denominator)), denominator);
+                return *this;
+            }
+            // Postfix increment and decrement operators:
+            PackedFraction operator++(int) {
+                PackedFraction copy(*this);
+                ++(*this);
+                return copy;
+            }
+            PackedFraction operator--(int) {
+                PackedFraction copy(*this);
+                --(*this);
+                return copy;
+            }
+
+            // Orderings by cross products: exactLess multiplies them out;
+            // filteredLess first compares them in double and multiplies out
+            // only close calls. Each double is the exact product rounded at
+            // most three times (both conversions and the multiplication), so
+            // it is off by less than 2^-51 of itself, and a difference above
+            // 2^-50 of the magnitudes decides. With FRACTION_STATS,
+            // filteredLess counts how often each way decided.
+            //
+            // operator< uses exactLess: with 64 bit components that is two
+            // 64 x 64 -> 128 bit multiplications, a single instruction each
+            // on x86-64 and AArch64, and faster than the four conversions
+            // the filter needs. Targets without one can build with
+            // -DFRACTION_FILTERED_COMPARISONS to use filteredLess instead.
+            static bool exactLess(const PackedFraction& lhs, const PackedFraction& rhs) {
+                return static_cast<product>(lhs.numerator) * rhs.denominator <
+                       static_cast<product>(rhs.numerator) * lhs.denominator;
+            }
+            static bool filteredLess(const PackedFraction& lhs, const PackedFraction& rhs) {
+                double left = static_cast<double>(lhs.numerator) * static_cast<double>(rhs.denominator);
+                double right = static_cast<double>(rhs.numerator) * static_cast<double>(lhs.denominator);
+                double difference = right - left;
+                double bound = (fabs(left) + fabs(right)) * 0x1p-50;
+                if (difference > bound || difference < -bound) {
+                    FRACTION_STAT(filtered_comparisons);
+                    return difference > 0;
+                }
+
+                FRACTION_STAT(exact_comparisons);
+                return exactLess(lhs, rhs);
+            }
+
+            // Output operator:
+            friend ostream& operator<<(ostream& output, const PackedFraction& fraction) {
+                output << static_cast<long long>(fraction.numerator) << "/" << static_cast<unsigned long long>(fraction.denominator);
+                return output;
+            }
+    };
+
+    // 16 bit signed numerator, 16 bit unsigned denominator.
+    using Fraction32 = PackedFraction<int16_t, uint16_t>;
+    // 32 bit signed numerator, 32 bit unsigned denominator.
+    using Fraction64 = PackedFraction<int32_t, uint32_t>;
+    // 64 bit signed numerator, 64 bit unsigned denominator. Sums and
+    // differences whose cross products pass 2^127 throw overflow_error.
+    using Fraction128 = PackedFraction<int64_t, uint64_t>;
+
+    static_assert(sizeof(Fraction32) == 4);
+    static_assert(sizeof(Fraction64) == 8);
+    static_assert(sizeof(Fraction128) == 16);
+}
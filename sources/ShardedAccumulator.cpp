@@ -0,0 +1,102 @@
+#include "ShardedAccumulator.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace ariel
+{
+    // Each live thread holds a slot from the first time it adds until it
+    // exits, and always gets the lowest free one; so with at least as many
+    // shards as live threads no two threads share a shard, however many
+    // threads came and went before.
+    class SlotRegistry {
+        private:
+            mutex lock;
+            size_t next_slot = 0;
+            priority_queue<size_t, vector<size_t>, greater<size_t>> free_slots;
+
+        public:
+            size_t acquire() {
+                lock_guard<mutex> guard(lock);
+                if (free_slots.empty())
+                    return next_slot++;
+                size_t slot = free_slots.top();
+                free_slots.pop();
+                return slot;
+            }
+            void release(size_t slot) {
+                lock_guard<mutex> guard(lock);
+                free_slots.push(slot);
+            }
+    };
+
+    static SlotRegistry& slot_registry() {
+        // Never destroyed: threads may still exit after static destructors ran.
+        static SlotRegistry* registry = new SlotRegistry();
+        return *registry;
+    }
+
+    struct ThreadSlot {
+        size_t value;
+
+        ThreadSlot(): value(slot_registry().acquire()) {}
+        ~ThreadSlot() {
+            slot_registry().release(value);
+        }
+    };
+
+    static size_t thread_slot() {
+        thread_local ThreadSlot slot;
+        return slot.value;
+    }
+
+    ShardedAccumulator::Shard& ShardedAccumulator::local_shard() {
+        return shards[localShard()];
+    }
+
+    // Constructors:
+
+    ShardedAccumulator::ShardedAccumulator(size_t shard_count):
+        shards(shard_count != 0 ? shard_count : max(1U, thread::hardware_concurrency())) {}
+
+    size_t ShardedAccumulator::shardCount() const {
+        return shards.size();
+    }
+    size_t ShardedAccumulator::localShard() const {
+        return thread_slot() % shards.size();
+    }
+
+    // Writers:
+
+    void ShardedAccumulator::add(const Fraction& value) {
+        local_shard().partial.fetch_add(value, memory_order_relaxed);
+    }
+    ShardedAccumulator& ShardedAccumulator::operator+=(const Fraction& value) {
+        add(value);
+        return *this;
+    }
+
+    // Readers:
+
+    Fraction ShardedAccumulator::snapshot() const {
+        vector<Fraction> partials;
+        partials.reserve(shards.size());
+        for (const Shard& shard : shards)
+            partials.push_back(shard.partial.load(memory_order_acquire));
+
+        // Pairwise tree: each round halves the number of partial sums.
+        for (size_t width = 1; width < partials.size(); width *= 2)
+            for (size_t index = 0; index + width < partials.size(); index += 2 * width)
+                partials[index] = partials[index] + partials[index + width];
+
+        return partials[0];
+    }
+
+    void ShardedAccumulator::reset() {
+        for (Shard& shard : shards)
+            shard.partial.store(Fraction(), memory_order_relaxed);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "AtomicFraction.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace ariel
+{
+    // A running Fraction total for many writer threads.
+    // Each thread adds into its own cache line sized shard, so writers on
+    // different shards never contend. Readers merge the shards with a
+    // pairwise tree of additions, which keeps intermediate denominators
+    // balanced, and never block writers.
+    //
+    // A snapshot taken while threads are adding sees every shard at some
+    // point during the call, so it may or may not include the concurrent adds.
+    class ShardedAccumulator {
+        private:
+            static constexpr size_t cache_line = 64;
+
+            struct alignas(cache_line) Shard {
+                AtomicFraction partial;
+            };
+
+            vector<Shard> shards;
+
+            Shard& local_shard();
+
+        public:
+            // Constructors: (0 shards means one per hardware thread)
+            explicit ShardedAccumulator(size_t shard_count = 0);
+
+            size_t shardCount() const;
+            // The calling thread's shard. Live threads get distinct shards
+            // as long as there are no more of them than shards.
+            size_t localShard() const;
+
+            // Adds into the calling thread's shard. Throws overflow_error and
+            // leaves the shard unchanged if its partial sum would overflow.
+            void add(const Fraction& value);
+            ShardedAccumulator& operator+=(const Fraction& value);
+
+            // Sum of all shards.
+            Fraction snapshot() const;
+            // Zeroes every shard; adds running concurrently may survive.
+            void reset();
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ariel
+{
+    // LEB128 style variable length integers: 7 bits per byte, low bits
+    // first, high bit set on every byte but the last. A uint64_t takes at
+    // most max_varint_size bytes.
+    constexpr size_t max_varint_size = 10;
+
+    // Maps signed to unsigned so that small magnitudes stay small:
+    // 0, -1, 1, -2, 2 ... become 0, 1, 2, 3, 4 ...
+    inline uint64_t zigzag_encode(int64_t value) {
+        return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+    }
+    inline int64_t zigzag_decode(uint64_t value) {
+        return int64_t(value >> 1) ^ -int64_t(value & 1);
+    }
+
+    inline size_t varint_size(uint64_t value) {
+        size_t size = 1;
+        for (; value >= 0x80; value >>= 7)
+            size++;
+        return size;
+    }
+
+    // Writes value at out, which must have room for varint_size(value) bytes.
+    // Returns the position past the last byte written.
+    inline uint8_t* write_varint(uint8_t* out, uint64_t value) {
+        for (; value >= 0x80; value >>= 7)
+            *out++ = uint8_t(value | 0x80);
+        *out++ = uint8_t(value);
+        return out;
+    }
+
+    // Reads a varint from [in, end). Returns the position past it, or nullptr
+    // if the input ends first or the varint is longer than max_varint_size.
+    inline const uint8_t* read_varint(const uint8_t* in, const uint8_t* end, uint64_t& value) {
+        uint64_t result = 0;
+        for (unsigned shift = 0; in != end && shift < 7 * max_varint_size; shift += 7) {
+            uint8_t byte = *in++;
+            result |= uint64_t(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                value = result;
+                return in;
+            }
+        }
+        return nullptr;
+    }
+}
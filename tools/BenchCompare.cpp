@@ -0,0 +1,423 @@
+/**
+ * Compares two benchmark runs saved with --json or --csv (see
+ * benchmarks/BenchHarness.hpp), benchmark by benchmark.
+ *
+ * A difference counts only if Welch's t-test on the samples says it is
+ * significant at --alpha. A tracked benchmark (any, unless --track is given;
+ * --track TEXT can be repeated and matches names containing TEXT) that got
+ * slower by more than --threshold percent and significantly so is a
+ * regression, and the exit status is then 1. So is a tracked benchmark of
+ * the baseline that is missing from the current run, or has no samples
+ * there: renamed, crashed or filtered out.
+ *
+ * Usage: ./bench_compare [--threshold PCT] [--alpha P] [--track TEXT]... baseline current
+ */
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct Benchmark {
+    string name;
+    vector<double> samples;     // ns per operation
+
+    double mean() const {
+        double sum = 0;
+        for (double sample : samples)
+            sum += sample;
+        return sum / double(samples.size());
+    }
+    double variance() const {
+        if (samples.size() < 2)
+            return 0;
+        double average = mean();
+        double sum = 0;
+        for (double sample : samples)
+            sum += (sample - average) * (sample - average);
+        return sum / double(samples.size() - 1);
+    }
+};
+
+struct Run {
+    string cpu;
+    string compiler;
+    vector<Benchmark> benchmarks;
+};
+
+static int usage() {
+    cerr << "Usage: bench_compare [--threshold PCT] [--alpha P] [--track TEXT]... baseline current" << endl;
+    return 2;
+}
+
+// Reading JSON, just enough of it for the files the harness writes.
+class JsonReader {
+    private:
+        const string& text;
+        size_t position = 0;
+
+        void skip_space() {
+            while (position < text.size() && isspace(static_cast<unsigned char>(text[position])))
+                position++;
+        }
+
+        [[noreturn]] void fail() const {
+            throw runtime_error("Malformed JSON at offset " + to_string(position));
+        }
+
+    public:
+        explicit JsonReader(const string& text_in): text(text_in) {}
+
+        // Consumes character if it is next.
+        bool accept(char character) {
+            skip_space();
+            if (position < text.size() && text[position] == character) {
+                position++;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(char character) {
+            if (!accept(character))
+                fail();
+        }
+
+        string readString() {
+            expect('"');
+            string value;
+            while (position < text.size() && text[position] != '"') {
+                if (text[position] == '\\')
+                    position++;
+                if (position < text.size())
+                    value += text[position++];
+            }
+            expect('"');
+            return value;
+        }
+
+        double readNumber() {
+            skip_space();
+            const char* start = text.c_str() + position;
+            char* end = nullptr;
+            double value = strtod(start, &end);
+            if (end == start)
+                fail();
+            position += size_t(end - start);
+            return value;
+        }
+
+        // Skips any value: string, number, literal, array or object.
+        void skipValue() {
+            skip_space();
+            if (position >= text.size())
+                fail();
+            char next = text[position];
+            if (next == '"') {
+                readString();
+            }
+            else if (next == '[' || next == '{') {
+                char close = next == '[' ? ']' : '}';
+                position++;
+                if (accept(close))
+                    return;
+                do {
+                    if (close == '}') {
+                        readString();
+                        expect(':');
+                    }
+                    skipValue();
+                } while (accept(','));
+                expect(close);
+            }
+            else if (isalpha(static_cast<unsigned char>(next))) {
+                while (position < text.size() && isalpha(static_cast<unsigned char>(text[position])))
+                    position++;
+            }
+            else {
+                readNumber();
+            }
+        }
+};
+
+static Run read_json(const string& text) {
+    Run run;
+    JsonReader reader(text);
+    reader.expect('{');
+    do {
+        string key = reader.readString();
+        reader.expect(':');
+        if (key == "context") {
+            reader.expect('{');
+            do {
+                string field = reader.readString();
+                reader.expect(':');
+                if (field == "cpu")
+                    run.cpu = reader.readString();
+                else if (field == "compiler")
+                    run.compiler = reader.readString();
+                else
+                    reader.skipValue();
+            } while (reader.accept(','));
+            reader.expect('}');
+        }
+        else if (key == "benchmarks") {
+            reader.expect('[');
+            if (reader.accept(']'))
+                continue;
+            do {
+                Benchmark benchmark;
+                reader.expect('{');
+                do {
+                    string field = reader.readString();
+                    reader.expect(':');
+                    if (field == "name") {
+                        benchmark.name = reader.readString();
+                    }
+                    else if (field == "samples_ns") {
+                        reader.expect('[');
+                        if (!reader.accept(']')) {
+                            do
+                                benchmark.samples.push_back(reader.readNumber());
+                            while (reader.accept(','));
+                            reader.expect(']');
+                        }
+                    }
+                    else {
+                        reader.skipValue();
+                    }
+                } while (reader.accept(','));
+                reader.expect('}');
+                run.benchmarks.push_back(benchmark);
+            } while (reader.accept(','));
+            reader.expect(']');
+        }
+        else {
+            reader.skipValue();
+        }
+    } while (reader.accept(','));
+    reader.expect('}');
+    return run;
+}
+
+// Splits a CSV line; fields may be quoted, with "" for a quote.
+static vector<string> csv_fields(const string& line) {
+    vector<string> fields(1);
+    bool quoted = false;
+    for (size_t index = 0; index < line.size(); index++) {
+        char character = line[index];
+        if (quoted && character == '"' && index + 1 < line.size() && line[index + 1] == '"')
+            fields.back() += line[++index];
+        else if (character == '"')
+            quoted = !quoted;
+        else if (!quoted && character == ',')
+            fields.emplace_back();
+        else
+            fields.back() += character;
+    }
+    return fields;
+}
+
+static Run read_csv(istream& input) {
+    Run run;
+    vector<string> header;
+    size_t name_column = 0;
+    size_t samples_column = 0;
+    for (string line; getline(input, line);) {
+        if (line.empty())
+            continue;
+        if (line[0] == '#') {
+            if (line.compare(0, 7, "# cpu: ") == 0)
+                run.cpu = line.substr(7);
+            else if (line.compare(0, 12, "# compiler: ") == 0)
+                run.compiler = line.substr(12);
+            continue;
+        }
+        vector<string> fields = csv_fields(line);
+        if (header.empty()) {
+            header = fields;
+            for (size_t column = 0; column < header.size(); column++) {
+                if (header[column] == "name")
+                    name_column = column;
+                else if (header[column] == "samples_ns")
+                    samples_column = column;
+            }
+            if (samples_column == 0)
+                throw runtime_error("No samples_ns column");
+            continue;
+        }
+        if (fields.size() != header.size())
+            throw runtime_error("Malformed CSV line: " + line);
+        Benchmark benchmark{fields[name_column], {}};
+        istringstream samples(fields[samples_column]);
+        for (string sample; getline(samples, sample, ';');)
+            benchmark.samples.push_back(atof(sample.c_str()));
+        run.benchmarks.push_back(benchmark);
+    }
+    return run;
+}
+
+static Run read_run(const string& path) {
+    ifstream input(path);
+    if (!input)
+        throw runtime_error("Can't open " + path);
+    string text((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first != string::npos && text[first] == '{')
+        return read_json(text);
+    istringstream lines(text);
+    return read_csv(lines);
+}
+
+// The regularized incomplete beta function I_x(a, b), by its continued
+// fraction (modified Lentz).
+static double incomplete_beta(double a, double b, double x) {
+    if (x <= 0)
+        return 0;
+    if (x >= 1)
+        return 1;
+    if (x > (a + 1) / (a + b + 2))
+        return 1 - incomplete_beta(b, a, 1 - x);
+    const double tiny = 1e-300;
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1 - x)) / a;
+    double c = 1;
+    double d = 1 - (a + b) * x / (a + 1);
+    d = 1 / (fabs(d) < tiny ? tiny : d);
+    double result = d;
+    for (int m = 1; m <= 300; m++) {
+        for (int step = 0; step < 2; step++) {
+            double numerator = step == 0 ? m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m))
+                                         : -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+            d = 1 + numerator * d;
+            d = 1 / (fabs(d) < tiny ? tiny : d);
+            c = 1 + numerator / c;
+            c = fabs(c) < tiny ? tiny : c;
+            result *= c * d;
+        }
+        if (fabs(c * d - 1) < 1e-12)
+            break;
+    }
+    return front * result;
+}
+
+// Welch's t-test: the two-sided p-value of the hypothesis that the two
+// samples have the same mean, without assuming the same variance.
+static double welch_p_value(const Benchmark& lhs, const Benchmark& rhs) {
+    double lhs_count = double(lhs.samples.size());
+    double rhs_count = double(rhs.samples.size());
+    if (lhs_count < 2 || rhs_count < 2)
+        return 1;
+    double lhs_error = lhs.variance() / lhs_count;
+    double rhs_error = rhs.variance() / rhs_count;
+    double error = lhs_error + rhs_error;
+    if (error == 0)
+        return lhs.mean() == rhs.mean() ? 1 : 0;
+    double t = (lhs.mean() - rhs.mean()) / sqrt(error);
+    double freedom = error * error / (lhs_error * lhs_error / (lhs_count - 1) + rhs_error * rhs_error / (rhs_count - 1));
+    return incomplete_beta(freedom / 2, 0.5, freedom / (freedom + t * t));
+}
+
+int main(int argc, char** argv) {
+    double threshold = 5;
+    double alpha = 0.05;
+    vector<string> tracked;
+    int arg = 1;
+    for (; arg + 1 < argc && strncmp(argv[arg], "--", 2) == 0; arg++) {
+        string option = argv[arg];
+        if (option == "--threshold")
+            threshold = atof(argv[++arg]);
+        else if (option == "--alpha")
+            alpha = atof(argv[++arg]);
+        else if (option == "--track")
+            tracked.emplace_back(argv[++arg]);
+        else
+            return usage();
+    }
+    if (argc - arg != 2)
+        return usage();
+
+    try {
+        Run baseline = read_run(argv[arg]);
+        Run current = read_run(argv[arg + 1]);
+        if (baseline.cpu != current.cpu)
+            cout << "warning: different CPUs: " << baseline.cpu << " / " << current.cpu << endl;
+        if (baseline.compiler != current.compiler)
+            cout << "warning: different compilers: " << baseline.compiler << " / " << current.compiler << endl;
+
+        map<string, const Benchmark*> before;
+        for (const Benchmark& benchmark : baseline.benchmarks)
+            before[benchmark.name] = &benchmark;
+        map<string, const Benchmark*> after_by_name;
+        for (const Benchmark& benchmark : current.benchmarks)
+            after_by_name[benchmark.name] = &benchmark;
+        auto is_tracked = [&tracked](const string& name) {
+            bool result = tracked.empty();
+            for (const string& text : tracked)
+                result = result || name.find(text) != string::npos;
+            return result;
+        };
+
+        size_t regressions = 0;
+        cout << left << setw(44) << "benchmark" << right << setw(12) << "before" << setw(12) << "after"
+             << setw(10) << "change" << setw(10) << "p" << "  verdict" << endl;
+        for (const Benchmark& after : current.benchmarks) {
+            auto found = before.find(after.name);
+            if (found == before.end() || found->second->samples.empty()) {
+                cout << left << setw(44) << after.name << "  (not in the baseline)" << endl;
+                continue;
+            }
+            if (after.samples.empty())
+                continue;   // reported as missing below
+            const Benchmark& old = *found->second;
+            double change = 100 * (after.mean() / old.mean() - 1);
+            double p_value = welch_p_value(old, after);
+
+            string verdict = "same";
+            if (p_value < alpha)
+                verdict = change > 0 ? "slower" : "faster";
+            if (is_tracked(after.name) && p_value < alpha && change > threshold) {
+                verdict = "REGRESSION";
+                regressions++;
+            }
+            cout << left << setw(44) << after.name << right << fixed
+                 << setw(12) << setprecision(2) << old.mean() << setw(12) << after.mean()
+                 << setw(9) << setprecision(1) << showpos << change << "%" << noshowpos
+                 << setw(10) << setprecision(4) << p_value << "  " << verdict << endl;
+        }
+
+
+        // What the baseline has and the current run lacks.
+        size_t missing = 0;
+        for (const Benchmark& old : baseline.benchmarks) {
+            auto found = after_by_name.find(old.name);
+            if (old.samples.empty() || (found != after_by_name.end() && !found->second->samples.empty()))
+                continue;
+            if (is_tracked(old.name)) {
+                cout << left << setw(44) << old.name << "  MISSING from the current run" << endl;
+                missing++;
+            }
+            else
+                cout << left << setw(44) << old.name << "  (not in the current run)" << endl;
+        }
+
+        if (regressions > 0)
+            cout << defaultfloat << regressions << " regression(s) over " << threshold << "%" << endl;
+        if (missing > 0)
+            cout << missing << " tracked benchmark(s) missing from the current run" << endl;
+        if (regressions > 0 || missing > 0)
+            return 1;
+    }
+    catch (const exception& error) {
+        cerr << "bench_compare: " << error.what() << endl;
+        return 2;
+    }
+}
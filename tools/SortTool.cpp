@@ -0,0 +1,55 @@
+/**
+ * Sorts a fraction file (see FractionFile.hpp) that may be larger than memory.
+ *
+ * Usage: ./fraction_sort [--memory MB] [--temp DIR] [--threads N] [--dedupe] input output
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+using namespace std;
+
+#include "ExternalSort.hpp"
+
+using namespace ariel;
+
+static int usage() {
+    cerr << "Usage: fraction_sort [--memory MB] [--temp DIR] [--threads N] [--dedupe] input output" << endl;
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    ExternalSortOptions options;
+    int arg = 1;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++) {
+        string option = argv[arg];
+        if (option == "--dedupe")
+            options.dedupe = true;
+        else if (arg + 1 == argc)
+            return usage();
+        else if (option == "--memory")
+            options.memory_budget = size_t(atoll(argv[++arg])) << 20;
+        else if (option == "--temp")
+            options.temp_directory = argv[++arg];
+        else if (option == "--threads")
+            options.threads = unsigned(atoi(argv[++arg]));
+        else
+            return usage();
+    }
+    if (argc - arg != 2)
+        return usage();
+
+    try {
+        auto start = chrono::steady_clock::now();
+        ExternalSortResult result = external_sort(argv[arg], argv[arg + 1], options);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << result.input_count << " values in, " << result.output_count << " out, "
+             << result.runs << " runs, " << elapsed.count() << " s" << endl;
+    }
+    catch (const exception& error) {
+        cerr << "fraction_sort: " << error.what() << endl;
+        return 1;
+    }
+}
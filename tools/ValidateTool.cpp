@@ -0,0 +1,184 @@
+/**
+ * Drives a FRACTION_VALIDATE build of the library (see FractionReference.hpp)
+ * with random operands, so that every arithmetic and comparison operator is
+ * checked against the __int128 reference; the first mismatch aborts with the
+ * operands. The operands favour the edges: zero, one, the extremes of int,
+ * powers of two and values around sqrt(INT_MAX), where the products start to
+ * overflow. Constructors, negation and ++ and -- are checked here.
+ *
+ * Usage: ./fraction_validate [--operations N] [--seed S]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+using namespace std;
+
+#include "FractionReference.hpp"
+
+using namespace ariel;
+
+static int usage() {
+    cerr << "Usage: fraction_validate [--operations N] [--seed S]" << endl;
+    return 2;
+}
+
+static int random_component(mt19937_64& random) {
+    const int int_max = numeric_limits<int>::max();
+    const int int_min = numeric_limits<int>::min();
+    const int edges[] = {0, 1, -1, 2, -2, int_max, int_min, int_max - 1, int_min + 1, 46340, 46341, -46340, -46341};
+    uint64_t bits = random();
+    int sign = (bits & 1) != 0 ? -1 : 1;
+    bits >>= 1;
+    switch (bits % 6) {
+        case 0:
+            return edges[(bits >> 3) % size(edges)];
+        case 1:
+            return sign * int((bits >> 3) % 100);
+        case 2:
+            return sign * (int(1) << (bits >> 3) % 31);
+        case 3:
+            return sign * (46341 - int((bits >> 3) % 64));
+        case 4:
+            return sign * int((bits >> 3) % 65536);
+        default:
+            return int(uint32_t(bits >> 3));
+    }
+}
+
+static string describe(const Fraction& value) {
+    return to_string(value.getNumerator()) + "/" + to_string(value.getDenominator());
+}
+
+// Fraction(numerator, denominator), checked against the reference.
+static bool make_fraction(int numerator, int denominator, Fraction& result) {
+    ReferenceResult expected = reference_fraction(numerator, denominator);
+    Fraction operands(0, 1);
+    try {
+        result = Fraction(numerator, denominator);
+    }
+    catch (const overflow_error&) {
+        if (!expected.overflow)
+            fraction_validation_failure("Fraction(" + to_string(numerator) + ", " + to_string(denominator) + ")",
+                                        operands, operands, describe_reference(expected), "overflow_error");
+        return false;
+    }
+    if (expected.overflow || result.getNumerator() != expected.numerator || result.getDenominator() != expected.denominator)
+        fraction_validation_failure("Fraction(" + to_string(numerator) + ", " + to_string(denominator) + ")", operands,
+                                    operands, describe_reference(expected), describe(result));
+    return true;
+}
+
+// -value, ++value and --value, checked against the reference. Returns how
+// many overflowed.
+static size_t check_unary(const Fraction& value) {
+    size_t overflows = 0;
+    const Fraction one(1, 1);
+    auto check = [&](const string& operation, const ReferenceResult& expected, auto compute) {
+        Fraction result;
+        try {
+            result = compute();
+        }
+        catch (const overflow_error&) {
+            if (!expected.overflow)
+                fraction_validation_failure(operation, value, one, describe_reference(expected), "overflow_error");
+            overflows++;
+            return;
+        }
+        if (expected.overflow || result.getNumerator() != expected.numerator || result.getDenominator() != expected.denominator)
+            fraction_validation_failure(operation, value, one, describe_reference(expected), describe(result));
+    };
+    check("negated", reference_fraction(-static_cast<long long>(value.getNumerator()), value.getDenominator()),
+          [&] { return -value; });
+    check("incremented", reference_fraction(static_cast<long long>(value.getNumerator()) + value.getDenominator(),
+                                            value.getDenominator()),
+          [&] {
+              Fraction copy(value);
+              return ++copy;
+          });
+    check("decremented", reference_fraction(static_cast<long long>(value.getNumerator()) - value.getDenominator(),
+                                            value.getDenominator()),
+          [&] {
+              Fraction copy(value);
+              return --copy;
+          });
+    return overflows;
+}
+
+static volatile int sink;
+
+int main(int argc, char** argv) {
+    uint64_t operations = 10000000;
+    uint64_t seed = 2023;
+    for (int arg = 1; arg < argc; arg++) {
+        string option = argv[arg];
+        if (arg + 1 == argc)
+            return usage();
+        else if (option == "--operations")
+            operations = strtoull(argv[++arg], nullptr, 10);
+        else if (option == "--seed")
+            seed = strtoull(argv[++arg], nullptr, 10);
+        else
+            return usage();
+    }
+
+    if (!fraction_validation_enabled()) {
+        cerr << "fraction_validate: the library wasn't built with FRACTION_VALIDATE" << endl;
+        return 2;
+    }
+
+    mt19937_64 random(seed);
+    uint64_t checked = 0, overflows = 0;
+    auto start = chrono::steady_clock::now();
+    while (checked < operations) {
+        Fraction lhs, rhs;
+        int denominator = 0;
+        while (denominator == 0)
+            denominator = random_component(random);
+        checked++;
+        if (!make_fraction(random_component(random), denominator, lhs)) {
+            overflows++;
+            continue;
+        }
+        denominator = 0;
+        while (denominator == 0)
+            denominator = random_component(random);
+        checked++;
+        if (!make_fraction(random_component(random), denominator, rhs)) {
+            overflows++;
+            continue;
+        }
+
+        // The library checks these itself.
+        for (char operation : {'+', '-', '*', '/'}) {
+            if (operation == '/' && rhs.getNumerator() == 0)
+                continue;
+            checked++;
+            try {
+                switch (operation) {
+                    case '+': sink = (lhs + rhs).getNumerator(); break;
+                    case '-': sink = (lhs - rhs).getNumerator(); break;
+                    case '*': sink = (lhs * rhs).getNumerator(); break;
+                    default: sink = (lhs / rhs).getNumerator(); break;
+                }
+            }
+            catch (const overflow_error&) {
+                overflows++;
+            }
+        }
+        sink = (lhs < rhs) + (rhs < lhs) + (lhs == rhs);
+        checked += 3;
+
+        overflows += check_unary(lhs);
+        checked += 3;
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    cout << checked << " operations matched the reference (" << overflows << " overflows), seed " << seed << ", "
+         << elapsed.count() << " s" << endl;
+}